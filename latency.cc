@@ -62,6 +62,30 @@ static double ** eresults;								// store experimental results
 int rgroup1[GROUP1], rgroup2[GROUP2];
 #endif // RANDOM
 
+// SIZED => compare sized (C23 free_sized/free_aligned_sized) and unsized deallocation, if the allocator provides them.
+//#define SIZED
+#ifdef SIZED
+#define ALIGN 64
+extern "C" void free_sized( void * addr, size_t size );
+extern "C" void free_aligned_sized( void * addr, size_t alignment, size_t size );
+#endif // SIZED
+
+// BATCH => compare batch allocation/free (malloc_batch/free_batch) with individual malloc/free, if the allocator provides them.
+//#define BATCH
+#ifdef BATCH
+extern "C" size_t malloc_batch( size_t size, size_t n, void ** out );
+extern "C" void free_batch( void ** ptrs, size_t n );
+#endif // BATCH
+
+// SPREAD => allocation sizes spread over the buckets between the small-size lookup and the mmap crossover, which
+// exercise the size-class computation for larger sizes.
+//#define SPREAD
+#ifdef SPREAD
+#define SPREAD_MIN 65'536
+#define SPREAD_MAX 1'048'576
+size_t spread[GROUP1];
+#endif // SPREAD
+
 #define PRINT_DOTS
 #ifdef PRINT_DOTS
 #define DOTS() if ( tid == 0 ) { printf( "." ); fflush( stdout ); }
@@ -94,6 +118,19 @@ static const char * titles[] = {
 	"rgroup " xstr(GROUP1) " malloc/reverse-free 1-"  xstr(GROUP1) " bytes\t\t",
 	"rgroup " xstr(GROUP2) " malloc/reverse-free 1-"  xstr(GROUP2) " bytes\t\t",
 	#endif // RANDOM
+	#ifdef SIZED
+	"alternate malloc/free_sized " xstr(FIXED) " bytes\t\t\t",
+	"group " xstr(GROUP2) " malloc/free_sized 1-"  xstr(GROUP2) " bytes\t\t",
+	"alternate aligned_alloc/free " xstr(ALIGN) "/" xstr(FIXED) " bytes\t\t",
+	"alternate aligned_alloc/free_aligned_sized " xstr(ALIGN) "/" xstr(FIXED) " bytes",
+	#endif // SIZED
+	#ifdef BATCH
+	"group " xstr(GROUP1) " malloc_batch/free_batch " xstr(FIXED) " bytes\t\t",
+	"group " xstr(GROUP2) " malloc_batch/free_batch " xstr(FIXED) " bytes\t\t",
+	#endif // BATCH
+	#ifdef SPREAD
+	"group " xstr(GROUP1) " malloc/free " xstr(SPREAD_MIN) "-" xstr(SPREAD_MAX) " bytes\t\t",
+	#endif // SPREAD
 	#endif // MALLOC
 	#ifdef MMAP
 	"mmap alternate malloc/free " xstr(FIXED2) " bytes\t\t",
@@ -410,6 +447,120 @@ static void * worker( void * arg ) {
 	pthread_barrier_wait( &barrier );
 	#endif // RANDOM
 
+
+	#ifdef SIZED
+	// alternate malloc/free_sized FIXED bytes, compare with alternate malloc/free FIXED bytes
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES; i += 1 ) {
+		cp = (char *)pass( malloc( FIXED ) );
+		assert( cp );
+		cp[0] = cp[FIXED - 1] = 'a';					// touch ends
+		free_sized( cp, FIXED );
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+
+
+	// group malloc/free_sized 1-GROUP2 bytes, compare with group malloc/free 1-GROUP2 bytes
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES / GROUP2; i += 1 ) {
+		for ( uint64_t g = 0; g < GROUP2; g += 1 ) {
+			cps2[g] = (char *)pass( malloc( g ) );
+			assert( cps2[g] );
+			if ( g ) cps2[g][0] = cps2[g][g - 1] = 'a';	// touch ends
+		} // for
+		for ( uint64_t g = 0; g < GROUP2; g += 1 ) {
+			free_sized( cps2[g], g );
+		} // for
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+
+
+	// alternate aligned_alloc/free ALIGN/FIXED bytes
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES; i += 1 ) {
+		cp = (char *)pass( aligned_alloc( ALIGN, FIXED ) );
+		assert( cp );
+		cp[0] = cp[FIXED - 1] = 'a';					// touch ends
+		free( cp );
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+
+
+	// alternate aligned_alloc/free_aligned_sized ALIGN/FIXED bytes
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES; i += 1 ) {
+		cp = (char *)pass( aligned_alloc( ALIGN, FIXED ) );
+		assert( cp );
+		cp[0] = cp[FIXED - 1] = 'a';					// touch ends
+		free_aligned_sized( cp, ALIGN, FIXED );
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+	#endif // SIZED
+
+
+	#ifdef BATCH
+	// group malloc_batch/free_batch GROUP1 FIXED bytes, compare with group malloc/free GROUP1 FIXED bytes
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES / GROUP1; i += 1 ) {
+		if ( malloc_batch( FIXED, GROUP1, (void **)cps1 ) != GROUP1 ) abort();
+		for ( uint64_t g = 0; g < GROUP1; g += 1 ) {
+			cps1[g][0] = cps1[g][FIXED - 1] = 'a';		// touch ends
+		} // for
+		free_batch( (void **)pass( cps1 ), GROUP1 );
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+
+
+	// group malloc_batch/free_batch GROUP2 FIXED bytes, compare with group malloc/free GROUP2 FIXED bytes
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES / GROUP2; i += 1 ) {
+		if ( malloc_batch( FIXED, GROUP2, (void **)cps2 ) != GROUP2 ) abort();
+		for ( uint64_t g = 0; g < GROUP2; g += 1 ) {
+			cps2[g][0] = cps2[g][FIXED - 1] = 'a';		// touch ends
+		} // for
+		free_batch( (void **)pass( cps2 ), GROUP2 );
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+	#endif // BATCH
+
+
+	#ifdef SPREAD
+	// group malloc/free GROUP1 SPREAD_MIN-SPREAD_MAX bytes, touch only the ends to measure the allocator
+	start = currTime();
+	for ( uint64_t i = 0; i < TIMES / GROUP1 / 10; i += 1 ) {
+		for ( uint64_t g = 0; g < GROUP1; g += 1 ) {
+			cps1[g] = (char *)pass( malloc( spread[g] ) );
+			assert( cps1[g] );
+			cps1[g][0] = cps1[g][spread[g] - 1] = 'a';	// touch ends
+		} // for
+		for ( uint64_t g = 0; g < GROUP1; g += 1 ) {
+			free( cps1[g] );
+		} // for
+	} // for
+	etime = dur( currTime(), start );
+	eresults[exp++][tid] = etime;
+	DOTS();
+	pthread_barrier_wait( &barrier );
+	#endif // SPREAD
+
 	gettimeofday( &tnow, 0 );
 	getrusage( RUSAGE_SELF, &rnow );
 	if ( tid == 0 ) {
@@ -563,6 +714,12 @@ int main() {
 	} // for
 	#endif // RANDOM
 
+	#ifdef SPREAD
+	for ( uint64_t i = 0; i < GROUP1; i += 1 ) {
+		spread[i] = SPREAD_MIN + rand() % (SPREAD_MAX - SPREAD_MIN);
+	} // for
+	#endif // SPREAD
+
 	#if defined( plg2 )
 	unsigned int THREADS[] = { 4 };
 	#else
@@ -9,9 +9,14 @@
 #include <cerrno>										// errno, ENOMEM, EINVAL
 #include <cassert>										// assert
 #include <cstdint>										// uintptr_t, uint64_t, uint32_t
-#include <unistd.h>										// STDERR_FILENO, sbrk, sysconf, write
-#include <sys/mman.h>									// mmap, munmap
+#include <new>											// align_val_t, nothrow_t, get_new_handler, bad_alloc
+#include <ctime>										// clock_gettime
+#include <unistd.h>										// STDERR_FILENO, sbrk, sysconf, write, read, close
+#include <fcntl.h>										// open
+#include <sys/syscall.h>								// SYS_getcpu, SYS_gettid, SYS_mbind
+#include <sys/mman.h>									// mmap, munmap, madvise
 #include <pthread.h>									// pthread_key_create, pthread_setspecific
+#include <sched.h>										// sched_getcpu
 
 
 // pthread mutex locks are used because they handle priority inversion in real-time operating systems.
@@ -29,8 +34,39 @@
 	statement ;	\
 	_Pragma ( "GCC diagnostic pop" )
 
-#define __FASTLOOKUP__									// use O(1) table lookup from allocation size to bucket size for small allocations
+#define __FASTLOOKUP__									// use O(1) lookup from allocation size to bucket size
+// Per-CPU heaps are shared, so freed memory stays with the freeing CPU; __NOOWNERSHIP__ selects the global depot.
+#if ! defined( __PERCPU__ ) && ! defined( __NOOWNERSHIP__ )
 #define __OWNERSHIP__									// return freed memory to owner thread
+#endif // ! __PERCPU__ && ! __NOOWNERSHIP__
+
+#if ! defined( __OWNERSHIP__ ) && ! defined( __PERCPU__ )
+#define __DEPOT__										// bound free storage per heap bucket with a global depot
+#endif // ! __OWNERSHIP__ && ! __PERCPU__
+
+#if defined( __SLAB__ ) && defined( __PERCPU__ )	// slabs are owned by a thread heap
+#error __SLAB__ is not supported with __PERCPU__
+#endif // __SLAB__ && __PERCPU__
+
+#if defined( __COMPACT_HEADER__ ) && ( defined( __PERCPU__ ) || __SIZEOF_POINTER__ != 8 ) // rseq links at offset 0, 48-bit addresses
+#error __COMPACT_HEADER__ is only supported on 64-bit without __PERCPU__
+#endif // __COMPACT_HEADER__
+
+// Per-CPU heaps use restartable sequences (rseq) for free-list operations, when glibc registers rseq for each thread.
+#if defined( __PERCPU__ ) && defined( __x86_64__ ) && __GLIBC_PREREQ( 2, 35 )
+#define __RSEQ__
+#include <sys/rseq.h>									// struct rseq, RSEQ_SIG, __rseq_offset, __rseq_size
+#endif // __PERCPU__ && __x86_64__ && glibc >= 2.35
+
+// Static tracepoints (USDT) on the slow paths, e.g., "perf probe sdt_llheap:manager_extend" after "perf buildid-cache
+// --add libllheap.so", or "bpftrace -e 'usdt:./program:llheap:remote_pull { ... }'". An unattached probe is a nop with
+// its arguments in registers. Without systemtap's <sys/sdt.h> or with __NOPROBES__, the probes are elided.
+#if __has_include( <sys/sdt.h> ) && ! defined( __NOPROBES__ )
+#include <sys/sdt.h>									// STAP_PROBEV
+#define LLPROBE( name, ... ) STAP_PROBEV( llheap, name, __VA_ARGS__ )
+#else
+#define LLPROBE( name, ... )
+#endif // <sys/sdt.h> && ! __NOPROBES__
 
 #define LIKELY(x) __builtin_expect(!!(x), 1)
 #define UNLIKELY(x) __builtin_expect(!!(x), 0)
@@ -155,18 +191,28 @@ static inline __attribute__((always_inline)) size_t Bsearchl( unsigned int key,
 #define Fai( change, inc ) __atomic_fetch_add( (&(change)), (inc), __ATOMIC_SEQ_CST )
 #define Tas( lock ) __atomic_test_and_set( (&(lock)), __ATOMIC_ACQUIRE )
 #define Clr( lock ) __atomic_clear( (&(lock)), __ATOMIC_RELEASE )
+#define Fao( change, mask ) __atomic_fetch_or( (&(change)), (mask), __ATOMIC_SEQ_CST )
+#define Fand( change, mask ) __atomic_fetch_and( (&(change)), (mask), __ATOMIC_SEQ_CST )
 #define Fas( change, assn ) __atomic_exchange_n( (&(change)), (assn), __ATOMIC_SEQ_CST )
 #define Cas( change, comp, assn ) ({decltype(comp) __temp = (comp); __atomic_compare_exchange_n( (&(change)), (&(__temp)), (assn), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ); })
 #define Casv( change, comp, assn ) __atomic_compare_exchange_n( (&(change)), (&(comp)), (assn), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )
 
+// The statistics and debug counters of a CPU heap are shared by the threads running on the CPU, so they are updated atomically.
+#ifdef __PERCPU__
+#define StatAdd( counter, inc ) __atomic_fetch_add( &(counter), (inc), __ATOMIC_RELAXED )
+#else
+#define StatAdd( counter, inc ) ((counter) += (inc))
+#endif // __PERCPU__
+
 
 //######################### Back Trace #########################
 
 
 // Need to compile with -rdynamic to get symbol names in back trace.
 
-#ifdef __DEBUG__
 #include <execinfo.h>									// backtrace, backtrace_symbols
+
+#ifdef __DEBUG__
 #include <cxxabi.h>										// __cxa_demangle
 
 static void Backtrace( int start ) {
@@ -287,10 +333,15 @@ static void sigSegvBusHandler( __SIGPARMS__ ) {
 
 
 #ifdef __STATISTICS__
-enum { CntTriples = 18 };								// number of counter triples
+#include <sys/resource.h>								// getrusage
+
+enum { CntTriples = 24 };								// number of counter triples
+enum { SizeBins = 1 + 4 * (36 - 4) };					// request-size bins: <= 16, then 4 per power of 2 up to 64G
+enum { LatencyBins = 2 + 3 * 7 };						// slow-path latency bins: 1-2-5 steps from 10ns to 100ms, then > 100ms
 struct HeapStatistics {
 	enum { MALLOC, AALLOC, CALLOC, RESIZE, REALLOC, REALLOCX /* realloc extras */, MEMALIGN, AMEMALIGN, CMEMALIGN,
-		   ALIGNED_ALLOC, POSIX_MEMALIGN, VALLOC, ALIGNED_RESIZE, ALIGNED_REALLOC, FREE };
+		   ALIGNED_ALLOC, POSIX_MEMALIGN, VALLOC, ALIGNED_RESIZE, ALIGNED_REALLOC, NEW, ALIGNED_NEW, DELETE, FREE };
+	enum { MANAGER_EXTEND, MASTER_EXTEND, MMAP_CALL, MUNMAP_CALL, REMOTE_PULL, SLOW_PATHS }; // timed slow paths
 	union {
 		// Statistic counters are unsigned long long int => use 64-bit counters on both 32 and 64 bit architectures.
 		// On 32-bit architectures, the 64-bit counters are simulated with multi-precise 32-bit computations.
@@ -309,20 +360,64 @@ struct HeapStatistics {
 			unsigned long long int valloc_calls, valloc_alloc_0_calls, valloc_alloc_request, valloc_alloc_alloc;
 			unsigned long long int aligned_resize_calls, aligned_resize_0_calls, aligned_resize_request, aligned_resize_alloc;
 			unsigned long long int aligned_realloc_calls, aligned_realloc_0_calls, aligned_realloc_request, aligned_realloc_alloc;
+			unsigned long long int new_calls, new_0_calls, new_request, new_alloc;
+			unsigned long long int aligned_new_calls, aligned_new_0_calls, aligned_new_request, aligned_new_alloc;
+			unsigned long long int delete_calls, delete_null_0_calls, delete_request, delete_alloc;
 			unsigned long long int free_calls, free_null_0_calls, free_request, free_alloc;
 			unsigned long long int remote_pushes, remote_pulls, remote_request, remote_alloc;
+			unsigned long long int mmap_cache_misses, mmap_cache_hits, mmap_cache_request, mmap_cache_alloc;
+			unsigned long long int depot_spills, depot_refills, depot_request, depot_alloc; // request => spilled, alloc => refilled
 			unsigned long long int mmap_calls, mmap_0_calls, /* no zero calls */ mmap_request, mmap_alloc;
+			unsigned long long int realloc_mremap_calls, realloc_mremap_0_calls, /* no zero calls */ realloc_mremap_request, realloc_mremap_alloc;
 			unsigned long long int munmap_calls, munmap_0_calls, /* no zero calls */ munmap_request, munmap_alloc;
 		};
 		struct {										// overlay for iteration
 			unsigned long long int calls, calls_0, request, alloc;
 		} counters[CntTriples];
 	};
+	unsigned long long int sizes[DELETE][SizeBins];		// request-size histogram per allocation API (REALLOCX unused)
+	unsigned long long int latency[SLOW_PATHS][LatencyBins]; // latency histogram per slow path
+	unsigned long long int latency_time[SLOW_PATHS], latency_faults[SLOW_PATHS]; // nanoseconds and minor page faults per slow path
 }; // HeapStatistics
 
-static_assert( sizeof(HeapStatistics) == CntTriples * sizeof(HeapStatistics::counters[0]),
+static_assert( offsetof(HeapStatistics, sizes) == CntTriples * sizeof(HeapStatistics::counters[0]),
 			   "Heap statistics counter-triplets does not match with array size" );
 
+// Log-linear request-size bins: bin 0 holds sizes <= 16, then there are 4 bins per power of 2, and the last bin holds
+// all larger sizes.
+static inline __attribute__((always_inline)) unsigned int sizeBin( size_t size ) {
+  if ( size <= 16 ) return 0;
+	unsigned int k = sizeof(size_t) * 8 - 1 - __builtin_clzl( size - 1 ); // size - 1 in [2^k, 2^(k+1))
+	unsigned int bin = 1 + (k - 4) * 4 + ((size - 1) >> (k - 2) & 3);
+	return Min( bin, (unsigned int)SizeBins - 1 );
+} // sizeBin
+
+static size_t sizeBinTop( unsigned int bin ) {			// largest size in bin
+  if ( bin == 0 ) return 16;
+	unsigned int k = (bin - 1) / 4 + 4;
+	return ((size_t)1 << k) + ((size_t)((bin - 1) % 4 + 1) << (k - 2));
+} // sizeBinTop
+
+// Log latency bins in 1-2-5 steps per decade: bin 0 holds latencies <= 10ns, bin LatencyBins - 2 holds latencies
+// <= 100ms, and the last bin holds all longer latencies.
+static unsigned int latencyBin( unsigned long long int ns ) {
+	unsigned long long int decade = 10;
+	unsigned int bin = 0;
+	for ( ; bin < LatencyBins - 2; decade *= 10, bin += 3 ) {
+	  if ( ns <= decade ) return bin;
+	  if ( ns <= 2 * decade ) return bin + 1;
+	  if ( ns <= 5 * decade ) return bin + 2;
+	} // for
+	return ns <= decade ? bin : bin + 1;
+} // latencyBin
+
+static unsigned long long int latencyBinTop( unsigned int bin ) { // largest latency in bin (nanoseconds)
+	static const unsigned int steps[] = { 1, 2, 5 };
+	unsigned long long int top = 10;
+	for ( unsigned int d = 0; d < bin / 3; d += 1 ) top *= 10;
+	return top * steps[bin % 3];
+} // latencyBinTop
+
 static bool print_buckets = false;
 static pthread_mutex_t printlock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -340,6 +435,14 @@ static HeapStatistics & operator+=( HeapStatistics & lhs, const HeapStatistics &
 		lhs.counters[i].request += rhs.counters[i].request;
 		lhs.counters[i].alloc += rhs.counters[i].alloc;
 	} // for
+	for ( unsigned int i = 0; i < HeapStatistics::DELETE; i += 1 ) {
+		for ( unsigned int b = 0; b < SizeBins; b += 1 ) lhs.sizes[i][b] += rhs.sizes[i][b];
+	} // for
+	for ( unsigned int i = 0; i < HeapStatistics::SLOW_PATHS; i += 1 ) {
+		for ( unsigned int b = 0; b < LatencyBins; b += 1 ) lhs.latency[i][b] += rhs.latency[i][b];
+		lhs.latency_time[i] += rhs.latency_time[i];
+		lhs.latency_faults[i] += rhs.latency_faults[i];
+	} // for
 	return lhs;
 } // ::operator+=
 #endif // __STATISTICS__
@@ -359,18 +462,28 @@ struct Heap {
 		struct Header {									// header
 			union Kind {
 				struct RealHeader {						// 4-byte word => 8-byte header, 8-byte word => 16-byte header
+					#ifdef __COMPACT_HEADER__
+					size_t size;						// mapped allocation size in bytes, otherwise data of the previous block
+					#endif // __COMPACT_HEADER__
 					union {
 						// 2nd low-order bit => zero filled, 3rd low-order bit => mmapped
 						FreeHeader * home;				// allocated block points back to home free header (must overlay alignment in fake header)
 						size_t blockSize;				// size for munmap (must overlay alignment)
 						Storage * next;					// freed block points to next freed block of same size
 					};
+					#ifndef __COMPACT_HEADER__
 					size_t size;						// allocation size in bytes
+					#endif // ! __COMPACT_HEADER__
 				} real; // RealHeader
 
 				struct FakeHeader {
+					#ifdef __COMPACT_HEADER__
+					uintptr_t offset;
+					uintptr_t alignment;				// 1st low-order bit => fake header & alignment
+					#else
 					uintptr_t alignment;				// 1st low-order bit => fake header & alignment
 					uintptr_t offset;
+					#endif // __COMPACT_HEADER__
 				} fake; // FakeHeader
 			} kind; // Kind
 		} header; // Header
@@ -387,11 +500,17 @@ struct Heap {
 		size_t blockSize;								// size of allocations on this list
 		#if defined( __STATISTICS__ )
 		size_t allocations, reuses;
+		size_t request;									// sum of request sizes => internal fragmentation
 		#endif // __STATISTICS__
 
 		#ifdef __OWNERSHIP__
 		CALIGN Storage * remoteList;					// other thread remote list
 		#endif // __OWNERSHIP__
+
+		#ifdef __DEPOT__
+		unsigned int freeCount;							// blocks on free list, possibly an underestimate
+		unsigned int depotBatch;						// blocks per batch exchanged with the depot
+		#endif // __DEPOT__
 	}; // FreeHeader
 
 	// Recursive definitions: HeapManager needs size of bucket array and bucket area needs sizeof HeapManager storage.
@@ -399,8 +518,51 @@ struct Heap {
 	enum { NoBucketSizes = 64 };						// number of bucket sizes
 
 	FreeHeader freeLists[NoBucketSizes];				// buckets for different allocation sizes
+
+	#ifdef __OWNERSHIP__
+	// Remote frees are chained per destination bucket and pushed onto its remote list with a single CAS when a chain is
+	// full, its slot is needed for another bucket, the thread allocates, or the thread terminates.
+	enum { RemoteSlots = 8, RemoteChain = 32 };			// chains of pending remote frees, frees per chain
+
+	struct RemoteBatch {
+		FreeHeader * freeHead;							// destination bucket, nullptr => empty
+		Storage * first, * last;						// chain of freed blocks, last link is nullptr
+		size_t count;									// blocks in chain
+	} remoteBatches[RemoteSlots];
+	size_t remoteBatched;								// non-empty chains
+
+	// Set by remote frees, so the owner finds returned storage without scanning the buckets.
+	CALIGN unsigned long int remotePending;				// bit per bucket with a non-empty remote list
+	#endif // __OWNERSHIP__
 	void * bufStart;									// start of current buffer
 	size_t bufRemaining;								// remaining free storage in buffer
+	unsigned int purgeTick;								// frees remaining before the next decay check
+	unsigned long long int purgeTime;					// time of last decay check (nanoseconds)
+	ptrdiff_t sampleCountdown;							// bytes allocated before the next heap-profile sample
+	uint64_t sampleSeed;								// random state for sample intervals
+
+	// An explicit heap (heap_create) maps its thread blocks and large allocations as extents, which heap_destroy
+	// releases together. Extents are doubly linked, so a large allocation is removed in O(1) when freed.
+	struct alignas( __ALIGN__ ) Extent {
+		Extent * next, * prev;							// extents of the heap
+		size_t size;									// mapping size for munmap
+	};
+	Extent * extents;									// explicit heap's extents
+	bool explicitHeap;									// created by heap_create, not a thread heap
+
+	#ifdef __SLAB__
+	// Small malloc/new requests are served from header-less slabs of SlabSize bytes, one size class per slab.
+	enum { SlabSize = 64 * 1024, SlabClasses = 8, SlabMax = SlabClasses * 16 }; // classes 16, 32, ..., SlabMax bytes
+	struct Slab;
+	Slab * slabs[SlabClasses];							// allocating slab per class
+	Slab * slabPartial[SlabClasses];					// other slabs with blocks freed by this heap
+	Slab * slabNotify[SlabClasses];						// lock-free stack of slabs with blocks freed by other heaps
+	#endif // __SLAB__
+
+	#ifdef __PERCPU__
+	pthread_mutex_t bufLock;							// protects buffer, as threads running on the CPU share the heap
+	pthread_mutex_t listLock;							// protects free lists without restartable sequences
+	#endif // __PERCPU__
 
 	#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
 	Heap * nextHeapManager;								// intrusive link of existing heaps; traversed to collect statistics or check unfreed storage
@@ -416,48 +578,140 @@ struct Heap {
 	#endif // __STATISTICS__
 }; // Heap
 
+#ifdef __SLAB__
+// A slab is a SlabSize-aligned block of the slab region with this descriptor at its start, so the descriptor of an
+// allocation is found by masking its address. Blocks freed by the owner heap go on the free list, and blocks freed by
+// other threads go on the lock-free remote list. The first remote free pushes the slab onto the owner's notify stack,
+// so the owner finds remote frees without scanning its slabs.
+struct CALIGN Heap::Slab {
+	struct Block { Block * next; };						// free block
+	Heap * owner;										// heap allocating from the slab
+	unsigned int blockSize;								// size class
+	Block * freeList;									// blocks freed by the owner
+	char * bump;										// next never-allocated block
+	Slab * nextPartial;									// owner's partial list
+	Slab * nextNotify;									// owner's notify stack
+	CALIGN Block * remoteList;							// blocks freed by other threads
+}; // Slab
+
+#define SlabOf( addr ) ((Heap::Slab *)((uintptr_t)(addr) & ~(uintptr_t)(Heap::SlabSize - 1)))
+#define SlabBlock( addr ) ((uintptr_t)(addr) - (uintptr_t)heapMaster.slabStart < heapMaster.slabExtent) // in slab region ?
+#endif // __SLAB__
+
+
+// Size classes (bucket sizes) are selected at compile time by __SIZE_CLASSES__:
+//   0 => hand-tuned table (default)
+//   1 => 16-byte spacing to 64 bytes, 4 classes per power of 2 to 64K, then 2 classes per power of 2
+//   2 => 16-byte spacing to 256 bytes, 4 classes per power of 2 to 16K, then 2 classes per power of 2
+// or by __SIZE_CLASSES_FILE__, naming a file of NoBucketSizes comma-separated bucket sizes, e.g., the "Size classes"
+// line printed by malloc_stats. The compiled table is replaced at startup by malloc_size_classes or the environment
+// variable MALLOC_SIZE_CLASSES (see setSizeClasses), e.g., with a table tuned to a workload by sizeclasses.cc.
+#ifndef __SIZE_CLASSES__
+#define __SIZE_CLASSES__ 0
+#endif // __SIZE_CLASSES__
+
+struct SizeClasses { unsigned long int sizes[Heap::NoBucketSizes]; };
+
+// Generate classes with 16-byte spacing up to linear * 16 bytes, then steps classes per power of 2 up to limit bytes,
+// then 2 classes per power of 2. A class is a request size plus the header.
+static constexpr SizeClasses sizeClassesGen( unsigned long int linear, unsigned long int steps, unsigned long int limit ) {
+	SizeClasses table = {};
+	unsigned long int size = 0;
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) {
+		unsigned long int pow2 = 1;
+		while ( pow2 * 2 <= size ) pow2 *= 2;			// largest power of 2 <= size
+		size += b < linear ? 16 : pow2 / (size < limit ? steps : 2);
+		table.sizes[b] = size + sizeof(Heap::Storage);
+	} // for
+	return table;
+} // sizeClassesGen
+
+static constexpr SizeClasses sizeClasses =
+#if defined( __SIZE_CLASSES_FILE__ )
+	{ {
+		#include __SIZE_CLASSES_FILE__
+	} };
+#elif __SIZE_CLASSES__ == 0
+	// Individual bucket sizes must be multiple of 16. Smaller multiples of 16 and powers of 2 are common allocation
+	// sizes, so make them generate the minimum required bucket size.
+	{ {
+		// There is no 0-sized bucket becasue it is better to create a 16 byte bucket for rare malloc(0), which can be
+		// reused later by a 16-byte allocation.
+		16 + sizeof(Heap::Storage), 32 + sizeof(Heap::Storage), 48 + sizeof(Heap::Storage), 64 + sizeof(Heap::Storage), // 4
+		96 + sizeof(Heap::Storage), 128 + sizeof(Heap::Storage), // 2
+		160, 192, 224, 256 + sizeof(Heap::Storage), // 4
+		320, 384, 448, 512 + sizeof(Heap::Storage), // 4
+		640, 768, 896, 1'024 + sizeof(Heap::Storage), // 4
+		1'536, 2'048 + sizeof(Heap::Storage), // 2
+		2'560, 3'072, 3'584, 4'096 + sizeof(Heap::Storage), // 4
+		6'144, 8'192 + sizeof(Heap::Storage), // 2
+		10'240, 12'288, 14'336, 16'384 + sizeof(Heap::Storage), // 4
+		20'480, 24'576, 28'672, 32'768 + sizeof(Heap::Storage), // 4
+		40'960, 49'152, 57'344, 65'536 + sizeof(Heap::Storage), // 4
+		81'920, 98'304, 114'688, 131'072 + sizeof(Heap::Storage), // 4
+		163'840, 196'608, 229'376, 262'144 + sizeof(Heap::Storage), // 4
+		327'680, 393'216, 458'752, 524'288 + sizeof(Heap::Storage), // 4
+		786'432, 1'048'576 + sizeof(Heap::Storage), // 2
+		1'572'864, 2'097'152 + sizeof(Heap::Storage), // 2
+		3'145'728, 4'194'304 + sizeof(Heap::Storage), // 2
+		6'291'456, 8'388'608 + sizeof(Heap::Storage), 12'582'912, 16'777'216 + sizeof(Heap::Storage), // 4
+		25'165'824 + sizeof(Heap::Storage), 33'554'432 + sizeof(Heap::Storage), // 2
+		50'331'648 + sizeof(Heap::Storage), 67'108'864 + sizeof(Heap::Storage), // 2
+	} };
+#elif __SIZE_CLASSES__ == 1
+	sizeClassesGen( 4, 4, 65'536 );
+#elif __SIZE_CLASSES__ == 2
+	sizeClassesGen( 16, 4, 16'384 );
+#else
+	#error unknown __SIZE_CLASSES__ policy
+#endif // __SIZE_CLASSES_FILE__
 
-// Size of array must harmonize with NoBucketSizes and individual bucket sizes must be multiple of 16.
-// Smaller multiples of 16 and powers of 2 are common allocation sizes, so make them generate the minimum required bucket size.
-static const unsigned int CALIGN bucketSizes[] = {		// different bucket sizes
-	// There is no 0-sized bucket becasue it is better to create a 16 byte bucket for rare malloc(0), which can be
-	// reused later by a 16-byte allocation.
-	16 + sizeof(Heap::Storage), 32 + sizeof(Heap::Storage), 48 + sizeof(Heap::Storage), 64 + sizeof(Heap::Storage), // 4
-	96 + sizeof(Heap::Storage), 128 + sizeof(Heap::Storage), // 2
-	160, 192, 224, 256 + sizeof(Heap::Storage), // 4
-	320, 384, 448, 512 + sizeof(Heap::Storage), // 4
-	640, 768, 896, 1'024 + sizeof(Heap::Storage), // 4
-	1'536, 2'048 + sizeof(Heap::Storage), // 2
-	2'560, 3'072, 3'584, 4'096 + sizeof(Heap::Storage), // 4
-	6'144, 8'192 + sizeof(Heap::Storage), // 2
-	10'240, 12'288, 14'336, 16'384 + sizeof(Heap::Storage), // 4
-	20'480, 24'576, 28'672, 32'768 + sizeof(Heap::Storage), // 4
-	40'960, 49'152, 57'344, 65'536 + sizeof(Heap::Storage), // 4
-	81'920, 98'304, 114'688, 131'072 + sizeof(Heap::Storage), // 4
-	163'840, 196'608, 229'376, 262'144 + sizeof(Heap::Storage), // 4
-	327'680, 393'216, 458'752, 524'288 + sizeof(Heap::Storage), // 4
-	786'432, 1'048'576 + sizeof(Heap::Storage), // 2
-	1'572'864, 2'097'152 + sizeof(Heap::Storage), // 2
-	3'145'728, 4'194'304 + sizeof(Heap::Storage), // 2
-	6'291'456, 8'388'608 + sizeof(Heap::Storage), 12'582'912, 16'777'216 + sizeof(Heap::Storage), // 4
-	25'165'824 + sizeof(Heap::Storage), 33'554'432 + sizeof(Heap::Storage), // 2
-	50'331'648 + sizeof(Heap::Storage), 67'108'864 + sizeof(Heap::Storage), // 2
-};
+// Classes must be increasing multiples of 16 holding more than a header.
+static constexpr bool sizeClassesCheck( const unsigned long int sizes[], size_t dimension ) {
+	for ( size_t b = 0; b < dimension; b += 1 ) {
+		if ( sizes[b] % 16 != 0 || sizes[b] <= (b == 0 ? sizeof(Heap::Storage) : sizes[b - 1]) || sizes[b] > UINT_MAX ) return false;
+	} // for
+	return true;
+} // sizeClassesCheck
 
-static_assert( Heap::NoBucketSizes == sizeof(bucketSizes) / sizeof(bucketSizes[0] ), "size of bucket array is wrong" );
+static_assert( sizeClassesCheck( sizeClasses.sizes, Heap::NoBucketSizes ), "size classes must be NoBucketSizes increasing multiples of 16" );
+
+static unsigned int CALIGN bucketSizes[Heap::NoBucketSizes]; // size classes in use, set at startup (see setSizeClasses)
 
 #ifdef __FASTLOOKUP__
-enum { LookupSizes = 65'536 + sizeof(Heap::Storage) };	// number of fast lookup sizes
-static unsigned char CALIGN lookup[LookupSizes];		// O(1) lookup for small sizes
+// Size classes are multiples of 16, so small sizes are looked up at 16-byte granularity in a table fitting in L1 (4K
+// entries). Larger sizes start from the first class in their power-of-2 range, found with count leading zeros, and step
+// over the few classes in that range.
+enum { LookupSizes = 65'536 + sizeof(Heap::Storage) };	// fast lookup sizes
+static unsigned char CALIGN lookup[(LookupSizes + 15) / 16 + 1]; // O(1) lookup for small sizes, 16-byte granularity
+static unsigned char CALIGN powerLookup[sizeof(size_t) * 8 + 1]; // first class > 2^(k-1) for sizes in (2^(k-1), 2^k]
 #endif // __FASTLOOKUP__
 
 
-// Manipulate sticky bits stored in unused 3 low-order bits of an address.
+// Manipulate sticky bits stored in unused 5 low-order bits of an address.
 //   bit0 => alignment => fake header
 //   bit1 => zero filled (calloc)
 //   bit2 => mapped allocation versus sbrk
-#define StickyBits( header ) (((header)->kind.real.blockSize & 0x7))
-#define ClearStickyBits( addr ) (decltype(addr))((uintptr_t)(addr) & ~7)
+//   bit3 => mapped allocation reused from the mmap cache, so not zero filled (mapped allocations only)
+//   bit4 => sampled by the heap profiler, so the sample is removed when freed
+static_assert( alignof(Heap::FreeHeader) >= 32, "home address has fewer than 5 unused low-order bits" );
+#define StickyBits( header ) (((header)->kind.real.blockSize & 0x1f))
+#ifdef __COMPACT_HEADER__
+// An allocated block has an 8-byte header, the word before its data, and its data extends over the first word of the
+// next block, which is only used when that block is free or mapped. The header word holds the home free-header pointer
+// with the sticky bits in the low-order bits, and the unused bytes after the request (delta) in the high-order bits
+// above the 48-bit user address space. A delta too large for its field is escaped and the request size is stored in
+// the last word of the unused bytes. Mapped storage keeps the request size in the word before the header.
+enum : size_t { HeaderSize = sizeof(uintptr_t), DeltaShift = 48, DeltaEscape = 0xffff };
+#define ClearStickyBits( addr ) (decltype(addr))((uintptr_t)(addr) & ~31 & (((uintptr_t)1 << DeltaShift) - 1))
+#define Home( header ) (ClearStickyBits( (header)->kind.real.home ))
+#else
+enum : size_t { HeaderSize = sizeof(Heap::Storage) };
+#define ClearStickyBits( addr ) (decltype(addr))((uintptr_t)(addr) & ~31)
+#define Home( header ) ((header)->kind.real.home)
+#endif // __COMPACT_HEADER__
+// Bytes of a block's data overlapping the next block, so the storage after the last bump-allocated block is reserved.
+enum : size_t { HeaderOverlap = sizeof(Heap::Storage) - HeaderSize };
 #define MarkAlignmentBit( alignment ) ((alignment) | 1)
 #define AlignmentBit( header ) ((((header)->kind.fake.alignment) & 1))
 #define ClearAlignmentBit( header ) (((header)->kind.fake.alignment) & ~1)
@@ -466,6 +720,12 @@ static unsigned char CALIGN lookup[LookupSizes];		// O(1) lookup for small sizes
 #define MarkZeroFilledBit( header ) ((header)->kind.real.blockSize |= 2)
 #define MmappedBit( header ) ((((header)->kind.real.blockSize) & 4))
 #define MarkMmappedBit( size ) ((size) | 4)
+#define MmappedReusedBit( header ) ((((header)->kind.real.blockSize) & 8))
+#define MarkMmappedReusedBit( size ) ((size) | 8)
+#define SampledBit( header ) ((((header)->kind.real.blockSize) & 16))
+#define MarkSampledBit( header ) ((header)->kind.real.blockSize |= 16)
+#define ClearSampledBit( header ) ((header)->kind.real.blockSize &= ~16)
+#define MmappedSize( header ) (((header)->kind.real.blockSize) & ~31) // mapped size is a multiple of the page size
 
 
 enum {
@@ -486,9 +746,69 @@ enum {
 
 	// The default unfreed storage amount in units of bytes. When the program ends it subtracts this amount from
 	// the malloc/free counter to adjust for storage the program does not free.
-	__DEFAULT_HEAP_UNFREED__ = 0
+	__DEFAULT_HEAP_UNFREED__ = 0,
+
+	// The default decay time in units of milliseconds. Free storage idle for longer than the decay time is returned
+	// to the operating system; 0 => never return free storage.
+	__DEFAULT_PURGE_DECAY__ = 0,
+
+	// The number of frees on a heap between checks of the decay time, which amortizes reading the clock.
+	__PURGE_TICKS__ = 4 * 1024,
+
+	// The default huge-page mode for heap reservations and thread blocks (see HugePages).
+	__DEFAULT_HUGE_PAGES__ = 0,
+
+	// The huge-page size when the OS does not report it.
+	__DEFAULT_HUGE_PAGE_SIZE__ = 2 * 1024 * 1024,
+
+	// The default maximum storage in units of bytes retained in the cache of freed mapped allocations; 0 => no cache.
+	__DEFAULT_MMAP_CACHE__ = 128 * 1024 * 1024,
+
+	// The number of freed mapped allocations retained in the cache.
+	__MMAP_CACHE_SLOTS__ = 16,
+
+	// The default NUMA mode (see setNuma).
+	__DEFAULT_NUMA__ = 0,
+
+	// The default policy for the storage of a terminating thread's heap (see ExitPolicy).
+	__DEFAULT_EXIT_POLICY__ = 0,
+
+	// Without ownership, a bucket holding more than __DEPOT_HIGH_WATER__ batches of free blocks spills a batch to the
+	// global depot, and an empty bucket refills a batch from the depot before extending its heap. A batch has about
+	// __DEPOT_BATCH_BYTES__ of storage, between 1 and __DEPOT_BATCH_MAX__ blocks.
+	__DEPOT_BATCH_BYTES__ = 64 * 1024,
+	__DEPOT_BATCH_MAX__ = 64,
+	__DEPOT_HIGH_WATER__ = 4,
+
+	// The maximum number of NUMA nodes with separate reservation pools; higher nodes share pools.
+	__NUMA_NODES__ = 16,
+
+	// The default average number of bytes allocated between heap-profile samples; 0 => no sampling.
+	__DEFAULT_SAMPLE_RATE__ = 0,
+
+	// Without sampling, a heap rereads the sample rate, which mallopt can change, after allocating this many bytes.
+	__SAMPLE_RECHECK__ = 64 * 1024 * 1024,
+
+	// The maximum number of live samples (power of 2) and return addresses recorded per sample.
+	__SAMPLE_SLOTS__ = 16 * 1024,
+	__SAMPLE_DEPTH__ = 32,
+
+	// The address space reserved for slabs, which bounds the storage of small allocations served from slabs; once the
+	// region is carved into slabs, small allocations come from the buckets.
+	__DEFAULT_SLAB_REGION__ = sizeof(void *) == 8 ? 4UL * 1024 * 1024 * 1024 : 256 * 1024 * 1024,
 }; // enum
 
+static_assert( __NUMA_NODES__ <= sizeof(unsigned long int) * 8, "NUMA node mask is one word" );
+
+// Huge-page modes: transparent huge pages (THP) are advised with madvise and the kernel backs them when possible;
+// hugetlb pages come from the preallocated huge-page pool, falling back to THP when the pool is empty.
+enum HugePages { NoHugePages = 0, TransparentHugePages = 1, HugetlbPages = 2 };
+
+// Exit policy for the heap of a terminating thread, which otherwise keeps its free storage until reused by a new
+// thread: drain the remote lists onto the free lists, release the whole free pages and unused buffer pages to the OS,
+// and/or donate the free blocks and buffer to a pool shared by all heaps. Flags can be combined.
+enum ExitPolicy { ExitKeep = 0, ExitDrain = 1, ExitTrim = 2, ExitDonate = 4, ExitAll = ExitDrain | ExitTrim | ExitDonate };
+
 static_assert( __DEFAULT_HEAP_EXTEND__ >= __DEFAULT_THREAD_BLOCK__, "Heap extension must be >= thread block size" );
 
 
@@ -496,19 +816,77 @@ struct HeapMaster {
 	pthread_mutex_t extLock;							// protects allocation-buffer extension
 	pthread_mutex_t mgrLock;							// protects freeHeapManagersList, heapManagersList, heapManagersStorage, heapManagersStorageEnd
 
-	void * sbrkStart;									// start of sbrk storage
-	void * sbrkEnd;										// end of sbrk area (logical end of heap)
-	size_t sbrkRemaining;								// amount of free storage at end of sbrk area
+	struct Pool {										// reservation pool per NUMA node
+		void * sbrkStart;								// start of sbrk storage
+		void * sbrkEnd;									// end of sbrk area (logical end of heap)
+		size_t sbrkRemaining;							// amount of free storage at end of sbrk area
+		#ifdef __STATISTICS__
+		unsigned long long int blocks, storage;			// thread blocks and storage from this node
+		#endif // __STATISTICS__
+	} pools[__NUMA_NODES__];
+	unsigned int numaNodes;								// number of pools in use, 1 => NUMA unaware
+	bool numaEmulate;									// emulated nodes => node is thread id modulo numaNodes
 	size_t sbrkExtend;									// sbrk extend amount
 	size_t sbrkThreadBlock;								// size of thread block carved from sbrk slab
 	size_t pageSize;									// architecture pagesize
+	size_t hugePageSize;								// architecture huge pagesize
+	unsigned int hugePages;								// huge-page mode for heap storage
 	size_t mmapStart;									// cross over point for mmap
 	size_t maxBucketsUsed;								// maximum number of buckets in use
+	unsigned long long int purgeDecay;					// idle time before free storage is returned to the OS (nanoseconds)
+	unsigned int exitPolicy;							// storage policy for heaps of terminating threads
+
+	// Free storage donated by terminating threads, taken by any heap before extending.
+	pthread_mutex_t donateLock;							// protects donated
+	Heap::Storage * donated[Heap::NoBucketSizes];		// free-block chain per bucket
+
+	#ifdef __DEPOT__
+	// Lock-free stack of batches per bucket. A batch is a chain of free blocks, and the batches are linked through the
+	// size field of each batch's first block.
+	struct CALIGN { Heap::Storage * top; } depot[Heap::NoBucketSizes];
+	#endif // __DEPOT__
+
+	#ifdef __PERCPU__
+	Heap * cpuHeaps;									// heap per CPU, subscripted by CPU number
+	unsigned int cpus;									// number of CPU heaps
+	bool rseq;											// free lists use restartable sequences, otherwise listLock
+	#endif // __PERCPU__
+
+	// Freed mapped allocations retained for reuse, unordered.
+	pthread_mutex_t mmapCacheLock;						// protects the mmap cache
+	size_t mmapCacheMax;								// maximum cached storage
+	size_t mmapCacheStorage;							// current cached storage
+	size_t mmapCacheCnt;								// number of cached mappings
+	struct {
+		Heap::Storage * block;							// mapping
+		size_t size;									// mapping size
+		unsigned long long int time;					// time mapping is cached (nanoseconds)
+	} mmapCache[__MMAP_CACHE_SLOTS__];
+
+	// Heap profile of sampled live allocations, in an open-addressing table keyed by block header and mapped on the
+	// first sample.
+	pthread_mutex_t sampleLock;							// protects the sample table and counters
+	size_t sampleRate;									// average bytes allocated between samples, 0 => no sampling
+	struct Sample {
+		Heap::Storage::Header * header;					// sampled block, nullptr => empty slot
+		size_t size;									// allocation size
+		size_t depth;									// return addresses in pcs
+		void * pcs[__SAMPLE_DEPTH__];					// call stack of the allocation
+	} * samples;
+	size_t sampleLive;									// samples in the table
+	unsigned long long int sampleCnt, sampleStorage, sampleDropped; // samples taken and their storage, samples dropped when the table is full
 
 	#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
 	Heap * heapManagersList;							// heap-stack head
 	#endif // __STATISTICS__ || __DEBUG__
 	Heap * freeHeapManagersList;						// free-stack head
+	Heap * freeExplicitHeapsList;						// free-stack head of destroyed explicit heaps, which have no storage
+
+	#ifdef __SLAB__
+	char * slabStart;									// region carved into slabs, nullptr => no slabs
+	size_t slabExtent;									// region size
+	size_t slabNext;									// offset of the next slab to carve
+	#endif // __SLAB__
 
 	// Heap superblocks are not linked; heaps in superblocks are linked via intrusive links.
 	Heap * heapManagersStorage;							// next heap to use in heap superblock
@@ -523,7 +901,14 @@ struct HeapMaster {
 	unsigned long long int blkContig, blkNoncontig, blkFragstorage; // (non-)contiguous blocks, external fragmenation in non-contiguous blocks
 	unsigned long long int threadsStarted, threadsExited; // threads that have started and exited
 	unsigned long long int heapNew, heapReused;			// heaps new and reused
+	unsigned long long int explicitCreated, explicitDestroyed, explicitReleased; // explicit heaps and storage released by heap_destroy
+	unsigned long long int slabPages, slabStorage;		// slabs carved and their storage
 	unsigned long long int sbrkCalls, sbrkStorage;
+	unsigned long long int trimCalls, trimStorage;		// malloc_trim calls and storage released to the OS
+	unsigned long long int purgeCalls, purgeStorage;	// decay purges and storage released to the OS
+	unsigned long long int exitCalls, exitReleased, exitDonated, donateReuses; // exit policies applied, storage released/donated, chains reused
+	unsigned long long int hugetlbPages, thpAdvisedPages, basePages; // heap storage mapped with hugetlb, THP advised, base pages
+	double nsPerCycle;									// cycle counter calibration for slow-path latencies
 	int stats_fd;
 	#endif // __STATISTICS__
 }; // HeapMaster
@@ -543,6 +928,44 @@ static volatile size_t heapMasterBootFlag = 0;			// trigger for first heap
 static HeapMaster CALIGN heapMaster;					// program global
 static thread_local Heap * heapManager CALIGN TLSMODEL = (Heap *)1; // singleton
 static pthread_key_t pthread_key CALIGN;				// used by pthread_key_create
+#ifdef __OWNERSHIP__
+// Set when the thread's heap is parked on the free-heap stack at thread exit, after its remote batches are flushed. Later
+// frees by the thread, e.g., from another key destructor, push remote blocks directly, as the heap can be reused.
+static thread_local bool heapExited TLSMODEL = false;
+#endif // __OWNERSHIP__
+
+#ifdef __STATISTICS__
+// Slow paths are timed with the processor cycle counter, which is cheap enough to read around every event, and the
+// cycles are converted to nanoseconds with the ratio calibrated in heapMasterCtor.
+static inline __attribute__((always_inline)) unsigned long long int cycleCount( void ) {
+	#if defined( __x86_64__ ) || defined( __i386__ )
+	return __builtin_ia32_rdtsc();
+	#elif defined( __aarch64__ )
+	unsigned long long int cycles;
+	asm volatile( "mrs %0, cntvct_el0" : "=r" (cycles) );
+	return cycles;
+	#else												// no cycle counter => nanoseconds
+	timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1'000'000'000ULL + t.tv_nsec;
+	#endif // __x86_64__ || __i386__
+} // cycleCount
+
+static unsigned long long int minorFaults( void ) {		// of calling thread
+	rusage usage;
+	getrusage( RUSAGE_THREAD, &usage );
+	return usage.ru_minflt;
+} // minorFaults
+
+// Count a slow path started at cycle start in its latency histogram, and the minor page faults taken since faults, if
+// the faults are counted for the path.
+static void slowPath( HeapStatistics & stats, unsigned int path, unsigned long long int start, unsigned long long int faults = ULLONG_MAX ) {
+	unsigned long long int ns = (cycleCount() - start) * heapMaster.nsPerCycle;
+	StatAdd( stats.latency[path][latencyBin( ns )], 1 );
+	StatAdd( stats.latency_time[path], ns );
+	if ( faults != ULLONG_MAX ) StatAdd( stats.latency_faults[path], minorFaults() - faults );
+} // slowPath
+#endif // __STATISTICS__
 static thread_local size_t PAD2 CALIGN TLSMODEL __attribute__(( unused )); // protect further false sharing
 
 #ifdef __DEBUG__
@@ -554,26 +977,247 @@ static size_t scrub_size = SCRUB_SIZE;
 #endif // __DEBUG__
 
 
+#ifdef __PERCPU__
+// Per-CPU heaps are shared by the threads running on a CPU, so heap count and hoarded storage scale with CPUs rather
+// than threads. A thread selects the heap of its current CPU on each allocation and free. With restartable sequences,
+// a free-list operation is a critical section on the current CPU's list, which the kernel aborts and restarts if the
+// thread is preempted, migrated, or signalled, so no atomic instructions or locks are needed. Otherwise, the free lists
+// of each heap are protected by listLock. The buffer is always protected by bufLock, as it is extended infrequently.
+
+#ifdef __RSEQ__
+static inline __attribute__((always_inline)) struct rseq * rseqArea( void ) { // this thread's rseq registration
+	return (struct rseq *)((char *)__builtin_thread_pointer() + __rseq_offset);
+} // rseqArea
+
+static_assert( offsetof( Heap::Storage, header.kind.real.next ) == 0, "free-list link must be first in the header" );
+
+// Start of a critical section: label 3 is the descriptor (start 1, commit end 2, abort 4), which is stored into
+// rseq_cs to arm the section. Register rax is set to the address of the free-list head in the current CPU's heap.
+#define RSEQ_START \
+	".pushsection __rseq_cs, \"aw\"\n\t" \
+	".balign 32\n\t" \
+	"3:\n\t" \
+	".long 0, 0\n\t"									/* version, flags */ \
+	".quad 1f, 2f - 1f, 4f\n\t"							/* start, post-commit offset, abort */ \
+	".popsection\n\t" \
+	"0:\n\t" \
+	"leaq 3b(%%rip), %%rax\n\t" \
+	"1:\n\t" \
+	"movq %%rax, 8(%[rseq])\n\t"						/* arm, rseq_cs = descriptor */ \
+	"movl 4(%[rseq]), %%eax\n\t"						/* cpu_id */ \
+	"imulq %[heapSize], %%rax, %%rax\n\t" \
+	"addq %[list], %%rax\n\t"
+
+// Abort handler, preceded by the signature the kernel checks, restarts the critical section.
+#define RSEQ_ABORT \
+	".pushsection __rseq_failure, \"ax\"\n\t" \
+	".byte 0x0f, 0xb9, 0x3d\n\t"						/* ud1 with signature as displacement */ \
+	".long " xstr( RSEQ_SIG ) "\n\t" \
+	"4:\n\t" \
+	"jmp 0b\n\t" \
+	".popsection\n\t"
+
+#define RSEQ_OPERANDS( offset ) \
+	[rseq] "r" (rseqArea()), [list] "r" ((char *)heapMaster.cpuHeaps + (offset)), [heapSize] "i" (sizeof(Heap))
+
+static inline __attribute__((always_inline)) Heap::Storage * rseqPop( size_t offset ) {
+	Heap::Storage * block;
+	asm volatile(
+		RSEQ_START
+		"movq (%%rax), %[block]\n\t"
+		"testq %[block], %[block]\n\t"
+		"jz 2f\n\t"
+		"movq (%[block]), %%rcx\n\t"					/* next */
+		"movq %%rcx, (%%rax)\n\t"						/* commit, head = next */
+		"2:\n\t"
+		RSEQ_ABORT
+		: [block] "=&r" (block)
+		: RSEQ_OPERANDS( offset )
+		: "rax", "rcx", "memory", "cc" );
+	return block;
+} // rseqPop
+
+static inline __attribute__((always_inline)) Heap::Storage * rseqPopAll( size_t offset ) {
+	Heap::Storage * list;
+	asm volatile(
+		RSEQ_START
+		"movq (%%rax), %[list_]\n\t"
+		"movq $0, (%%rax)\n\t"							/* commit, head = null */
+		"2:\n\t"
+		RSEQ_ABORT
+		: [list_] "=&r" (list)
+		: RSEQ_OPERANDS( offset )
+		: "rax", "memory", "cc" );
+	return list;
+} // rseqPopAll
+
+static inline __attribute__((always_inline)) void rseqPush( size_t offset, Heap::Storage * first, Heap::Storage * last ) {
+	asm volatile(
+		RSEQ_START
+		"movq (%%rax), %%rcx\n\t"
+		"movq %%rcx, (%[last])\n\t"						/* last->next = head, private until commit */
+		"movq %[first], (%%rax)\n\t"					/* commit, head = first */
+		"2:\n\t"
+		RSEQ_ABORT
+		:
+		: RSEQ_OPERANDS( offset ), [first] "r" (first), [last] "r" (last)
+		: "rax", "rcx", "memory", "cc" );
+} // rseqPush
+#endif // __RSEQ__
+
+#define FREE_LIST_OFFSET( bucket ) (offsetof( Heap, freeLists ) + (bucket) * sizeof(Heap::FreeHeader))
+
+static inline __attribute__((always_inline)) Heap * cpuHeap( void ) {
+	#ifdef __RSEQ__
+	if ( LIKELY( heapMaster.rseq ) ) return &heapMaster.cpuHeaps[rseqArea()->cpu_id]; // cpu_id < possible CPUs
+	#endif // __RSEQ__
+	return &heapMaster.cpuHeaps[(unsigned int)sched_getcpu() % heapMaster.cpus]; // -1 => some heap
+} // cpuHeap
+
+// With rseq, the free-list operations apply to the current CPU's heap, which may differ from heap after a migration;
+// any CPU heap is correct as the buckets are the same in all heaps.
+
+static inline __attribute__((always_inline)) Heap::Storage * freeListPop( Heap * heap, size_t bucket ) {
+	#ifdef __RSEQ__
+	if ( LIKELY( heapMaster.rseq ) ) return rseqPop( FREE_LIST_OFFSET( bucket ) );
+	#endif // __RSEQ__
+	pthread_mutex_lock( &heap->listLock );
+	Heap::Storage * block = heap->freeLists[bucket].freeList;
+	if ( block != nullptr ) heap->freeLists[bucket].freeList = block->header.kind.real.next;
+	pthread_mutex_unlock( &heap->listLock );
+	return block;
+} // freeListPop
+
+static inline __attribute__((always_inline)) Heap::Storage * freeListPopAll( Heap * heap, size_t bucket ) {
+	#ifdef __RSEQ__
+	if ( LIKELY( heapMaster.rseq ) ) return rseqPopAll( FREE_LIST_OFFSET( bucket ) );
+	#endif // __RSEQ__
+	pthread_mutex_lock( &heap->listLock );
+	Heap::Storage * list = heap->freeLists[bucket].freeList;
+	heap->freeLists[bucket].freeList = nullptr;
+	pthread_mutex_unlock( &heap->listLock );
+	return list;
+} // freeListPopAll
+
+// Push the chain first to last, whose last link is overwritten.
+static inline __attribute__((always_inline)) void freeListPush( Heap * heap, size_t bucket, Heap::Storage * first, Heap::Storage * last ) {
+	#ifdef __RSEQ__
+	if ( LIKELY( heapMaster.rseq ) ) { rseqPush( FREE_LIST_OFFSET( bucket ), first, last ); return; }
+	#endif // __RSEQ__
+	pthread_mutex_lock( &heap->listLock );
+	last->header.kind.real.next = heap->freeLists[bucket].freeList;
+	heap->freeLists[bucket].freeList = first;
+	pthread_mutex_unlock( &heap->listLock );
+} // freeListPush
+#endif // __PERCPU__
+
+
+#ifdef __OWNERSHIP__
+static_assert( Heap::NoBucketSizes <= sizeof(unsigned long int) * 8, "remote pending mask is one word" );
+
+// Push the chain first to last onto the remote list of a bucket and mark the bucket pending in the owner heap.
+static inline void remotePush( Heap::FreeHeader * freeHead, Heap::Storage * first, Heap::Storage * last ) {
+	last->header.kind.real.next = freeHead->remoteList;	// link chain to top node
+	// CAS resets last->header.kind.real.next = freeHead->remoteList on failure
+	while ( ! Casv( freeHead->remoteList, last->header.kind.real.next, first ) );
+	// Set after the push, so an owner clearing the bit before removing the list cannot miss the chain.
+	Heap * owner = freeHead->homeManager;
+	LLPROBE( remote_push, owner, freeHead - owner->freeLists, freeHead->blockSize );
+	unsigned long int bit = 1UL << (freeHead - owner->freeLists);
+	if ( (owner->remotePending & bit) == 0 ) Fao( owner->remotePending, bit ); // avoid writing a set bit
+} // remotePush
+
+// Move the remote list of a bucket onto its free list. The pending bit is cleared first, so a racing remote free sets
+// it again.
+static inline void remotePull( Heap * heap, Heap::FreeHeader * freeHead ) {
+	#ifdef __STATISTICS__
+	unsigned long long int start = cycleCount();
+	#endif // __STATISTICS__
+	Fand( heap->remotePending, ~(1UL << (freeHead - heap->freeLists)) );
+	Heap::Storage * list = Fas( freeHead->remoteList, nullptr );
+  if ( list == nullptr ) return;						// pulled before bit cleared ?
+	LLPROBE( remote_pull, heap, freeHead - heap->freeLists, freeHead->blockSize );
+	if ( freeHead->freeList != nullptr ) {				// append free list ?
+		Heap::Storage * last = list;
+		while ( last->header.kind.real.next ) last = last->header.kind.real.next;
+		last->header.kind.real.next = freeHead->freeList;
+	} // if
+	freeHead->freeList = list;
+
+	#ifdef __STATISTICS__
+	StatAdd( heap->stats.remote_pulls, 1 );
+	slowPath( heap->stats, HeapStatistics::REMOTE_PULL, start );
+	#endif // __STATISTICS__
+} // remotePull
+
+// Move the remote lists of all pending buckets onto their free lists, and then remove a block from bucket freeHead,
+// if specified.
+static Heap::Storage * remoteDrain( Heap * heap, Heap::FreeHeader * freeHead = nullptr ) {
+	for ( unsigned long int pending = heap->remotePending; pending != 0; pending &= pending - 1 ) {
+		remotePull( heap, &heap->freeLists[__builtin_ctzl( pending )] );
+	} // for
+  if ( freeHead == nullptr ) return nullptr;
+	Heap::Storage * block = freeHead->freeList;
+	if ( block != nullptr ) freeHead->freeList = block->header.kind.real.next;
+	return block;
+} // remoteDrain
+
+// Push a chain of pending remote frees onto the remote list of its destination bucket.
+static inline void remoteFlush( Heap * heap, Heap::RemoteBatch & batch ) {
+	remotePush( batch.freeHead, batch.first, batch.last );
+	batch.freeHead = nullptr;
+	batch.first = nullptr;
+	batch.count = 0;
+	heap->remoteBatched -= 1;
+} // remoteFlush
+
+static void remoteFlushAll( Heap * heap ) {
+	for ( size_t s = 0; s < Heap::RemoteSlots; s += 1 ) {
+		if ( heap->remoteBatches[s].freeHead != nullptr ) remoteFlush( heap, heap->remoteBatches[s] );
+	} // for
+	assert( heap->remoteBatched == 0 );
+} // remoteFlushAll
+#endif // __OWNERSHIP__
+
+
 // For sequential programs without linked options -pthread/-lpthread, pthread_key_create and pthread_setspecific
 // magically get resolved.
 
 
+#ifndef __PERCPU__
+static void heapExit( Heap * heap, unsigned int policy ); // forward
+#endif // ! __PERCPU__
+
 static void heapManagerDtor( void * ) {					// passed to pthread_key_create
 	assert( heapManager );
+	LLPROBE( thread_exit, heapManager );
+
+	#ifdef __OWNERSHIP__
+	if ( heapManager->remoteBatched != 0 ) remoteFlushAll( heapManager ); // publish pending remote frees
+	heapExited = true;									// no more batching in the parked heap
+	#endif // __OWNERSHIP__
+
+	#ifndef __PERCPU__									// CPU heaps are shared
+	if ( heapMaster.exitPolicy != ExitKeep ) heapExit( heapManager, heapMaster.exitPolicy );
+	#endif // ! __PERCPU__
 
 	pthread_mutex_lock( &heapMaster.mgrLock );			// protect heapMaster counters
 
+	#ifndef __PERCPU__									// CPU heaps are shared and never freed
 	// push heap onto stack of free heaps for reusability
 	heapManager->nextFreeHeapManager = heapMaster.freeHeapManagersList;
 	heapMaster.freeHeapManagersList = heapManager;
+	#endif // ! __PERCPU__
 
 	#ifdef __DEBUG__
 	LLDEBUG( debugprt( "heapManagerDtor %p %jd %jd\n", heapManager, heapManager->allocUnfreed, heapMaster.allocUnfreed ) );
 	#endif // __DEBUG__
 
 	#ifdef __STATISTICS__
+	#ifndef __PERCPU__
 	heapMaster.stats += heapManager->stats;				// retain this heap's statistics
 	HeapStatisticsCtor( heapManager->stats );			// reset heap counters for next usage
+	#endif // ! __PERCPU__
 	heapMaster.threadsExited += 1;
 	#endif // __STATISTICS__
 
@@ -581,24 +1225,338 @@ static void heapManagerDtor( void * ) {					// passed to pthread_key_create
 } // heapManagerDtor
 
 
+// Set the NUMA mode: 0 => NUMA unaware, 1 => one pool per OS node, N > 1 => emulate N nodes for testing, where a
+// thread's node is its thread id modulo N, so threads spread across pools on any computer, and pools are not bound.
+static void setNuma( size_t value ) {
+	heapMaster.numaEmulate = value > 1;
+	if ( value == 1 ) {									// OS nodes ?
+		// Online nodes are listed as ranges, e.g., "0-1" or "0,2-3"; the last number is the highest node.
+		value = 1;										// no NUMA support => single pool
+		if ( int fd = open( "/sys/devices/system/node/online", O_RDONLY ); fd != -1 ) {
+			char buf[128];
+			ssize_t len = read( fd, buf, sizeof(buf) - 1 );
+			close( fd );
+			if ( len > 0 ) {
+				buf[len] = '\0';
+				char * last = buf;
+				for ( char * p = buf; *p; p += 1 ) if ( *p == '-' || *p == ',' ) last = p + 1;
+				value = strtoul( last, nullptr, 10 ) + 1;
+			} // if
+		} // if
+	} // if
+	heapMaster.numaNodes = Max( Min( value, (size_t)__NUMA_NODES__ ), (size_t)1 );
+} // setNuma
+
+
+#ifdef __PERCPU__
+// Return the highest possible CPU id plus one, or 0 if unknown. Possible CPUs are listed as ranges, e.g., "0-7" or
+// "0-3,8-11", and include CPUs that can be hot added, so ids may exceed the number of configured CPUs.
+static long int possibleCpus( void ) {
+	long int cpus = 0;
+	if ( int fd = open( "/sys/devices/system/cpu/possible", O_RDONLY ); fd != -1 ) {
+		char buf[128];
+		ssize_t len = read( fd, buf, sizeof(buf) - 1 );
+		close( fd );
+		if ( len > 0 ) {
+			buf[len] = '\0';
+			char * last = buf;
+			for ( char * p = buf; *p; p += 1 ) if ( *p == '-' || *p == ',' ) last = p + 1;
+			cpus = strtol( last, nullptr, 10 ) + 1;
+		} // if
+	} // if
+	return cpus;
+} // possibleCpus
+#endif // __PERCPU__
+
+
+// Set the size classes to the compiled table, replaced by the table from malloc_size_classes or MALLOC_SIZE_CLASSES
+// (NoBucketSizes comma-separated sizes). A replacement must pass sizeClassesCheck and reach the mmap crossover;
+// otherwise, it is ignored.
+static void setSizeClasses( void ) {
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) bucketSizes[b] = sizeClasses.sizes[b];
+
+	unsigned long int sizes[Heap::NoBucketSizes];
+	auto install = [&sizes]() {
+	  if ( ! sizeClassesCheck( sizes, Heap::NoBucketSizes ) || sizes[Heap::NoBucketSizes - 1] < heapMaster.mmapStart ) return;
+		for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) bucketSizes[b] = sizes[b];
+	}; // install
+
+	if ( const unsigned int * sc = malloc_size_classes(); sc != nullptr ) {
+		for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) sizes[b] = sc[b];
+		install();
+	} // if
+	if ( char * sc = getenv( "MALLOC_SIZE_CLASSES" ); sc && sc[0] != '\0' ) {
+		char * end = sc;
+		size_t b = 0;
+		while ( b < Heap::NoBucketSizes ) {
+			errno = 0;
+			char * begin = end;
+			sizes[b] = strtoul( begin, &end, 10 );
+		  if ( end == begin || errno == ERANGE ) break;	// not a number ?
+			b += 1;
+		  if ( *end != ',' ) break;						// last number ?
+			end += 1;
+		} // while
+		if ( b == Heap::NoBucketSizes && *end == '\0' ) install(); // exact number of sizes ?
+	} // if
+} // setSizeClasses
+
+
+// The heap profiler samples an allocation on average every sampleRate allocated bytes. Each heap counts down a random
+// number of bytes from an exponential distribution (Poisson sampling), so an allocation of size bytes is sampled with
+// probability 1 - exp(-size / sampleRate), as pprof assumes when scaling the samples of a heap_v2 profile.
+static ptrdiff_t sampleInterval( Heap * heap ) {
+	size_t rate = heapMaster.sampleRate;				// read once as mallopt can change it
+  if ( rate == 0 ) return __SAMPLE_RECHECK__;			// no sampling ?
+	heap->sampleSeed = heap->sampleSeed * 6364136223846793005ULL + 1442695040888963407ULL; // 64-bit LCG
+	double u = (double)((heap->sampleSeed >> 11) + 1) * 0x1p-53; // uniform in (0, 1]
+
+	// -ln u without libm: u = m * 2^e with m in [1, 2), and ln m from its series in t = (m - 1) / (m + 1) <= 1/3.
+	uint64_t bits;
+	memcpy( &bits, &u, sizeof(bits) );
+	int e = (int)(bits >> 52) - 1023;
+	bits = (bits & ((1ULL << 52) - 1)) | (1023ULL << 52);
+	double m;
+	memcpy( &m, &bits, sizeof(m) );
+	double t = (m - 1) / (m + 1), t2 = t * t;
+	double interval = -(e * 0.6931471805599453 + 2 * t * (1 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 / 7)))) * rate;
+	return interval < (double)(PTRDIFF_MAX / 2) ? (ptrdiff_t)interval + 1 : PTRDIFF_MAX / 2;
+} // sampleInterval
+
+static_assert( (__SAMPLE_SLOTS__ & (__SAMPLE_SLOTS__ - 1)) == 0, "sample slots must be a power of 2" );
+enum { SampleMask = __SAMPLE_SLOTS__ - 1 };
+
+static inline size_t sampleHome( Heap::Storage::Header * header ) { // first slot probed for header
+	return (uint64_t)((uintptr_t)header >> 4) * 0x9e3779b97f4a7c15ULL >> (64 - __builtin_ctz( __SAMPLE_SLOTS__ ));
+} // sampleHome
+
+static size_t sampleFind( Heap::Storage::Header * header ) { // slot of header, otherwise an empty slot
+	size_t i = sampleHome( header );
+	while ( heapMaster.samples[i].header != nullptr && heapMaster.samples[i].header != header ) i = (i + 1) & SampleMask;
+	return i;
+} // sampleFind
+
+// Empty slot i, moving back later samples in the probe sequence whose home is at or before i, so a lookup never meets
+// an empty slot before its sample.
+static void sampleErase( size_t i ) {
+	HeapMaster::Sample * samples = heapMaster.samples;
+	for ( size_t j = (i + 1) & SampleMask; samples[j].header != nullptr; j = (j + 1) & SampleMask ) {
+		if ( ((j - sampleHome( samples[j].header )) & SampleMask) >= ((j - i) & SampleMask) ) {
+			samples[i] = samples[j];
+			i = j;
+		} // if
+	} // for
+	samples[i].header = nullptr;
+	heapMaster.sampleLive -= 1;
+} // sampleErase
+
+static thread_local bool sampling TLSMODEL = false;		// backtrace in progress, which can allocate
+
+// Called by doMalloc when the heap's countdown expires to record the allocation with its call stack, and mark its header
+// so free removes the sample. Only the first backtrace allocates, to load the unwinder, and it is made at startup or by
+// mallopt enabling sampling. A sample is dropped if the table is full.
+static void sampleMalloc( Heap * heap, Heap::Storage::Header * header, size_t size ) {
+	#ifdef __PERCPU__
+	Fas( heap->sampleCountdown, sampleInterval( heap ) ); // only the thread observing the expiry draws the interval
+	#else
+	heap->sampleCountdown = sampleInterval( heap );
+	#endif // __PERCPU__
+  if ( heapMaster.sampleRate == 0 || sampling ) return;	// no sampling or allocation by backtrace ?
+	void * pcs[__SAMPLE_DEPTH__ + 1];
+	sampling = true;
+	int depth = backtrace( pcs, __SAMPLE_DEPTH__ + 1 ) - 1; // drop sampleMalloc
+	sampling = false;
+
+	pthread_mutex_lock( &heapMaster.sampleLock );
+	if ( UNLIKELY( heapMaster.samples == nullptr ) ) {	// first sample ?
+		void * table = ::mmap( 0, sizeof(HeapMaster::Sample) * __SAMPLE_SLOTS__, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( table != MAP_FAILED ) heapMaster.samples = (HeapMaster::Sample *)table; // zero filled => empty slots
+	} // if
+	if ( UNLIKELY( heapMaster.samples == nullptr || heapMaster.sampleLive >= __SAMPLE_SLOTS__ / 4 * 3 ) ) { // no table or full ?
+		heapMaster.sampleDropped += 1;
+	} else {
+		HeapMaster::Sample & sample = heapMaster.samples[sampleFind( header )];
+		sample.header = header;
+		sample.size = size;
+		sample.depth = Max( depth, 0 );
+		memcpy( sample.pcs, pcs + 1, sample.depth * sizeof(void *) );
+		MarkSampledBit( header );
+		heapMaster.sampleLive += 1;
+		heapMaster.sampleCnt += 1;
+		heapMaster.sampleStorage += size;
+	} // if
+	pthread_mutex_unlock( &heapMaster.sampleLock );
+} // sampleMalloc
+
+static void sampleFree( Heap::Storage::Header * header ) { // header has the sampled bit
+	pthread_mutex_lock( &heapMaster.sampleLock );
+	size_t i = sampleFind( header );
+	if ( heapMaster.samples[i].header == header ) sampleErase( i );
+	pthread_mutex_unlock( &heapMaster.sampleLock );
+} // sampleFree
+
+static void sampleMove( Heap::Storage::Header * oheader, Heap::Storage::Header * nheader ) { // remapped block
+	pthread_mutex_lock( &heapMaster.sampleLock );
+	size_t i = sampleFind( oheader );
+	if ( heapMaster.samples[i].header == oheader ) {
+		HeapMaster::Sample sample = heapMaster.samples[i];
+		sampleErase( i );
+		sample.header = nheader;
+		heapMaster.samples[sampleFind( nheader )] = sample;
+		heapMaster.sampleLive += 1;
+	} // if
+	pthread_mutex_unlock( &heapMaster.sampleLock );
+} // sampleMove
+
+
+static void heapCtor( Heap * heap ) {
+	#ifdef __COMPACT_HEADER__
+	assert( (uintptr_t)(heap + 1) >> DeltaShift == 0 );	// home pointers fit below the request-size delta
+	#endif // __COMPACT_HEADER__
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) { // initialize free lists
+		heap->freeLists[b] = (Heap::FreeHeader){
+			.freeList = nullptr,
+			.homeManager = heap,
+			.blockSize = bucketSizes[b],
+
+			#if defined( __STATISTICS__ )
+			.allocations = 0,
+			.reuses = 0,
+			.request = 0,
+			#endif // __STATISTICS__
+
+			#ifdef __OWNERSHIP__
+			.remoteList = nullptr,
+			#endif // __OWNERSHIP__
+
+			#ifdef __DEPOT__
+			.freeCount = 0,
+			.depotBatch = (unsigned int)Max( Min( __DEPOT_BATCH_BYTES__ / bucketSizes[b], (unsigned int)__DEPOT_BATCH_MAX__ ), 1u ),
+			#endif // __DEPOT__
+		};
+	} // for
+
+	#ifdef __OWNERSHIP__
+	for ( size_t s = 0; s < Heap::RemoteSlots; s += 1 ) {
+		heap->remoteBatches[s] = (Heap::RemoteBatch){ .freeHead = nullptr, .first = nullptr, .last = nullptr, .count = 0 };
+	} // for
+	heap->remoteBatched = 0;
+	heap->remotePending = 0;
+	#endif // __OWNERSHIP__
+
+	heap->bufStart = nullptr;
+	heap->bufRemaining = 0;
+	heap->purgeTick = __PURGE_TICKS__;
+	heap->purgeTime = 0;
+	heap->sampleSeed = (uintptr_t)heap;					// different interval sequence per heap
+	heap->sampleCountdown = sampleInterval( heap );
+	heap->extents = nullptr;
+	heap->explicitHeap = false;
+	heap->nextFreeHeapManager = nullptr;
+
+	#ifdef __SLAB__
+	for ( size_t c = 0; c < Heap::SlabClasses; c += 1 ) {
+		heap->slabs[c] = heap->slabPartial[c] = heap->slabNotify[c] = nullptr;
+	} // for
+	#endif // __SLAB__
+
+	#ifdef __DEBUG__
+	heap->allocUnfreed = 0;
+	#endif // __DEBUG__
+
+	#ifdef __PERCPU__
+	heap->bufLock = PTHREAD_MUTEX_INITIALIZER;
+	heap->listLock = PTHREAD_MUTEX_INITIALIZER;
+	#endif // __PERCPU__
+} // heapCtor
+
+
 static void heapMasterCtor( void ) {
 	// Singleton pattern to initialize heap master
 	always_assert( heapMasterBootFlag == 0 );
 
 	heapMaster.pageSize = sysconf( _SC_PAGESIZE );
+	heapMaster.hugePageSize = __DEFAULT_HUGE_PAGE_SIZE__;
+	if ( int fd = open( "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", O_RDONLY ); fd != -1 ) {
+		char buf[32];
+		ssize_t len = read( fd, buf, sizeof(buf) - 1 );
+		close( fd );
+		if ( len > 0 ) {
+			buf[len] = '\0';
+			size_t temp = strtoull( buf, nullptr, 10 );
+			if ( temp > heapMaster.pageSize && (temp & (temp - 1)) == 0 ) heapMaster.hugePageSize = temp; // power of 2 ?
+		} // if
+	} // if
 
 	heapMaster.extLock = PTHREAD_MUTEX_INITIALIZER;
 	heapMaster.mgrLock = PTHREAD_MUTEX_INITIALIZER;
+	heapMaster.mmapCacheLock = PTHREAD_MUTEX_INITIALIZER;
+	heapMaster.donateLock = PTHREAD_MUTEX_INITIALIZER;
+	heapMaster.sampleLock = PTHREAD_MUTEX_INITIALIZER;
+
+	heapMaster.sampleRate = malloc_sample_rate();		// before heaps are created
+	if ( char * sr = getenv( "MALLOC_SAMPLE_RATE" ); sr && sr[0] != '\0' ) {
+		errno = 0;
+		long long int temp = strtoll( sr, nullptr, 10 );
+		if ( errno != ERANGE && temp >= 0 ) heapMaster.sampleRate = temp;
+	} // if
+	heapMaster.samples = nullptr;
+	heapMaster.sampleLive = 0;
+	heapMaster.sampleCnt = heapMaster.sampleStorage = heapMaster.sampleDropped = 0;
 
 //	char * end = (char *)sbrk( 0 );
 //	heapMaster.sbrkStart = heapMaster.sbrkEnd = sbrk( (char *)Ceiling( (long unsigned int)end, heapMaster.pageSize ) - end ); // move start of heap to page-size boundary
 
-	heapMaster.sbrkRemaining = 0;
+	for ( unsigned int n = 0; n < __NUMA_NODES__; n += 1 ) {
+		heapMaster.pools[n].sbrkStart = heapMaster.pools[n].sbrkEnd = nullptr;
+		heapMaster.pools[n].sbrkRemaining = 0;
+		#ifdef __STATISTICS__
+		heapMaster.pools[n].blocks = heapMaster.pools[n].storage = 0;
+		#endif // __STATISTICS__
+	} // for
+	setNuma( malloc_numa() );
+	if ( char * nu = getenv( "MALLOC_NUMA" ); nu && nu[0] != '\0' ) {
+		errno = 0;
+		long long int temp = strtoll( nu, nullptr, 10 );
+		if ( errno != ERANGE && temp >= 0 ) setNuma( temp );
+	} // if
 	heapMaster.sbrkExtend = Ceiling( malloc_heap_extend(), heapMaster.pageSize ); // round up
 	always_assert( heapMaster.sbrkExtend >= 256 * 1024 ); // multiple of pagesize and >= minimum
 	heapMaster.sbrkThreadBlock = malloc_thread_block();
 	always_assert( heapMaster.sbrkExtend >= heapMaster.sbrkThreadBlock );
 	heapMaster.mmapStart = malloc_mmap_start();
+	heapMaster.purgeDecay = malloc_purge_decay() * 1'000'000; // milliseconds to nanoseconds
+	if ( char * pd = getenv( "MALLOC_PURGE_DECAY" ); pd && pd[0] != '\0' ) {
+		errno = 0;
+		long long int temp = strtoll( pd, nullptr, 10 );
+		if ( errno != ERANGE && temp >= 0 ) heapMaster.purgeDecay = temp * 1'000'000;
+	} // if
+	heapMaster.hugePages = malloc_huge_pages();
+	if ( char * hp = getenv( "MALLOC_HUGE_PAGES" ); hp && hp[0] != '\0' ) {
+		errno = 0;
+		long long int temp = strtoll( hp, nullptr, 10 );
+		if ( errno != ERANGE && temp >= NoHugePages && temp <= HugetlbPages ) heapMaster.hugePages = temp;
+	} // if
+	always_assert( heapMaster.hugePages <= HugetlbPages );
+	heapMaster.mmapCacheMax = malloc_mmap_cache();
+	if ( char * mc = getenv( "MALLOC_MMAP_CACHE" ); mc && mc[0] != '\0' ) {
+		errno = 0;
+		long long int temp = strtoll( mc, nullptr, 10 );
+		if ( errno != ERANGE && temp >= 0 ) heapMaster.mmapCacheMax = temp;
+	} // if
+	heapMaster.mmapCacheStorage = heapMaster.mmapCacheCnt = 0;
+	heapMaster.exitPolicy = malloc_exit_policy();
+	if ( char * ep = getenv( "MALLOC_EXIT_POLICY" ); ep && ep[0] != '\0' ) {
+		errno = 0;
+		long long int temp = strtoll( ep, nullptr, 10 );
+		if ( errno != ERANGE && temp >= ExitKeep && temp <= ExitAll ) heapMaster.exitPolicy = temp;
+	} // if
+	always_assert( heapMaster.exitPolicy <= ExitAll );
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) heapMaster.donated[b] = nullptr;
+	#ifdef __DEPOT__
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) heapMaster.depot[b].top = nullptr;
+	#endif // __DEPOT__
+	setSizeClasses();									// after mmapStart
 
 	// Find the closest bucket size less than or equal to the mmapStart size.
 	heapMaster.maxBucketsUsed = Bsearchl( heapMaster.mmapStart, bucketSizes, Heap::NoBucketSizes ); // binary search
@@ -611,6 +1569,18 @@ static void heapMasterCtor( void ) {
 	heapMaster.heapManagersList = nullptr;
 	#endif // __STATISTICS__ || __DEBUG__
 	heapMaster.freeHeapManagersList = nullptr;
+	heapMaster.freeExplicitHeapsList = nullptr;
+
+	#ifdef __SLAB__
+	// Reserve the slab region aligned to the slab size; pages are backed when touched. No region => no slabs.
+	heapMaster.slabStart = nullptr;
+	heapMaster.slabExtent = heapMaster.slabNext = 0;
+	if ( void * region = mmap( nullptr, (size_t)__DEFAULT_SLAB_REGION__ + Heap::SlabSize, PROT_READ | PROT_WRITE,
+							   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 ); region != MAP_FAILED ) {
+		heapMaster.slabStart = (char *)Ceiling( (uintptr_t)region, Heap::SlabSize );
+		heapMaster.slabExtent = __DEFAULT_SLAB_REGION__;
+	} // if
+	#endif // __SLAB__
 
 	heapMaster.heapManagersStorage = nullptr;
 	heapMaster.heapManagersStorageEnd = nullptr;
@@ -621,8 +1591,24 @@ static void heapMasterCtor( void ) {
 	heapMaster.threadsStarted = 0;
 	heapMaster.threadsExited = 1;						// fake as final thread still running
 	heapMaster.heapReused = heapMaster.heapNew = 0;
+	heapMaster.explicitCreated = heapMaster.explicitDestroyed = heapMaster.explicitReleased = 0;
+	heapMaster.slabPages = heapMaster.slabStorage = 0;
 	heapMaster.sbrkCalls = heapMaster.sbrkStorage = 0;
+	heapMaster.trimCalls = heapMaster.trimStorage = 0;
+	heapMaster.purgeCalls = heapMaster.purgeStorage = 0;
+	heapMaster.exitCalls = heapMaster.exitReleased = heapMaster.exitDonated = heapMaster.donateReuses = 0;
+	heapMaster.hugetlbPages = heapMaster.thpAdvisedPages = heapMaster.basePages = 0;
 	heapMaster.stats_fd = STDERR_FILENO;
+
+	// Calibrate the cycle counter against the monotonic clock for 200 microseconds.
+	timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	unsigned long long int cycles = cycleCount(), start = t.tv_sec * 1'000'000'000ULL + t.tv_nsec, end;
+	do {
+		clock_gettime( CLOCK_MONOTONIC, &t );
+		end = t.tv_sec * 1'000'000'000ULL + t.tv_nsec;
+	} while ( end - start < 200'000 );
+	heapMaster.nsPerCycle = (double)(end - start) / (cycleCount() - cycles);
 	#endif // __STATISTICS__
 
 	#ifdef __DEBUG__
@@ -637,12 +1623,51 @@ static void heapMasterCtor( void ) {
 	signal( SIGBUS,  sigSegvBusHandler, SA_SIGINFO | SA_ONSTACK ); // Bus error, bad memory access (default: Core)
 	#endif // __DEBUG__
 
+	#ifdef __PERCPU__
+	// CPU ids are less than the highest possible CPU id plus one, which can exceed the number of configured CPUs.
+	long int possible __attribute__(( unused )) = possibleCpus();
+	heapMaster.cpus = Max( Max( sysconf( _SC_NPROCESSORS_CONF ), possible ), 1L );
+	size_t size = heapMaster.cpus * sizeof( Heap );
+	heapMaster.cpuHeaps = (Heap *)mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( UNLIKELY( heapMaster.cpuHeaps == MAP_FAILED ) ) { // failed ?
+		// Do not call strerror( errno ) as it may call malloc.
+		abort( "**** Error **** attempt to allocate CPU heaps of size %zu bytes and mmap failed with errno %d.", size, errno );
+	} // if
+	for ( unsigned int c = 0; c < heapMaster.cpus; c += 1 ) {
+		Heap * heap = &heapMaster.cpuHeaps[c];
+		heapCtor( heap );
+
+		#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
+		heap->nextHeapManager = heapMaster.heapManagersList;
+		heapMaster.heapManagersList = heap;
+		#endif // __STATISTICS__ || __DEBUG__
+
+		#ifdef __STATISTICS__
+		HeapStatisticsCtor( heap->stats );
+		heapMaster.heapNew += 1;
+		#endif // __STATISTICS__
+	} // for
+	#ifdef __RSEQ__
+	// rseq indexes the CPU heaps by CPU id without a bound, so it requires the possible CPUs to size the array.
+	heapMaster.rseq = __rseq_size > 0 && possible != 0;	// glibc registered rseq ? (disable with tunable glibc.pthread.rseq=0)
+	#else
+	heapMaster.rseq = false;
+	#endif // __RSEQ__
+	#endif // __PERCPU__
+
 	#ifdef __FASTLOOKUP__
-	for ( unsigned int i = 0, idx = 0; i < LookupSizes; i += 1 ) {
-		if ( i > bucketSizes[idx] ) idx += 1;
+	// A table whose largest class is below LookupSizes maps the larger sizes to the largest class, like bucketIndex, and
+	// these sizes are mmapped as the largest class reaches the mmap crossover.
+	for ( unsigned int i = 0, idx = 0; i < sizeof(lookup); i += 1 ) {
+		if ( i * 16 > bucketSizes[idx] && idx < Heap::NoBucketSizes - 1 ) idx += 1; // classes are multiples of 16 => at most one step
 		lookup[i] = idx;
-		always_assert( i <= bucketSizes[idx] ||			// overflow buckets ?
-					   i > bucketSizes[idx - 1] );		// overlapping bucket sizes ?
+		always_assert( i * 16 <= bucketSizes[idx] ||	// overflow buckets ?
+					   idx == Heap::NoBucketSizes - 1 ||	// beyond largest bucket ?
+					   i * 16 > bucketSizes[idx - 1] );	// overlapping bucket sizes ?
+	} // for
+	for ( size_t k = 0; k < sizeof(powerLookup); k += 1 ) {
+		size_t low = k == 0 ? 0 : 1ul << (k - 1);		// sizes in (low, 2 * low]
+		powerLookup[k] = low < bucketSizes[Heap::NoBucketSizes - 1] ? Bsearchl( low + 1, bucketSizes, Heap::NoBucketSizes ) : Heap::NoBucketSizes - 1;
 	} // for
 	#endif // __FASTLOOKUP__
 
@@ -650,8 +1675,57 @@ static void heapMasterCtor( void ) {
 } // HeapMaster::heapMasterCtor
 
 
+// Find the bucket for size, i.e., the first size class >= size, but at most the largest bucket used.
+static inline __attribute__((always_inline)) size_t bucketIndex( size_t size ) {
+	#ifdef __FASTLOOKUP__
+  if ( LIKELY( size < LookupSizes ) ) return lookup[(size + 15) / 16];
+	size_t b = powerLookup[sizeof(size_t) * 8 - __builtin_clzl( size - 1 )]; // start of power-of-2 range
+	while ( b < heapMaster.maxBucketsUsed && bucketSizes[b] < size ) b += 1;
+	return Min( b, heapMaster.maxBucketsUsed );
+	#else
+	return Bsearchl( size, bucketSizes, heapMaster.maxBucketsUsed ); // binary search
+	#endif // __FASTLOOKUP__
+} // bucketIndex
+
+
 #define NO_MEMORY_MSG "**** Error **** insufficient heap memory available to allocate %zd new bytes."
 
+#ifndef __PERCPU__
+// Create a heap from the current heap superblock. The caller must hold mgrLock.
+static Heap * newHeap( void ) {
+	// Heap size is about 12K, FreeHeader (128 bytes because of cache alignment) * NoBucketSizes (91) => 128 heaps *
+	// 12K ~= 120K byte superblock.  Where 128-heap superblock handles a medium sized multi-processor server.
+	size_t remaining = heapMaster.heapManagersStorageEnd - heapMaster.heapManagersStorage; // remaining free heaps in superblock
+	if ( ! heapMaster.heapManagersStorage || remaining == 0 ) {
+		// Each block of heaps is a multiple of the number of cores on the computer.
+		int dimension = malloc_thread_extend();
+		size_t size = dimension * sizeof( Heap );
+
+		heapMaster.heapManagersStorage = (Heap *)mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( UNLIKELY( heapMaster.heapManagersStorage == MAP_FAILED ) ) { // failed ?
+			if ( errno == ENOMEM ) abort( NO_MEMORY_MSG, size ); // no memory
+			// Do not call strerror( errno ) as it may call malloc.
+			abort( "**** Error **** attempt to allocate block of heaps of size %zu bytes and mmap failed with errno %d.", size, errno );
+		} // if
+		heapMaster.heapManagersStorageEnd = &heapMaster.heapManagersStorage[dimension]; // outside array
+	} // if
+
+	Heap * heap = heapMaster.heapManagersStorage;
+	heapMaster.heapManagersStorage = heapMaster.heapManagersStorage + 1; // bump next heap
+
+	#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
+	heap->nextHeapManager = heapMaster.heapManagersList;
+	heapMaster.heapManagersList = heap;
+	#endif // __STATISTICS__ || __DEBUG__
+
+	#ifdef __STATISTICS__
+	heapMaster.heapNew += 1;
+	#endif // __STATISTICS__
+
+	heapCtor( heap );
+	return heap;
+} // HeapMaster::newHeap
+
 static Heap * getHeap( void ) {
 	Heap * heap;
 	if ( heapMaster.freeHeapManagersList ) {			// free heap for reused ?
@@ -662,64 +1736,15 @@ static Heap * getHeap( void ) {
 		#ifdef __STATISTICS__
 		heapMaster.heapReused += 1;
 		#endif // __STATISTICS__
+		LLPROBE( heap_reuse, heap );
 	} else {											// free heap not found, create new
-		// Heap size is about 12K, FreeHeader (128 bytes because of cache alignment) * NoBucketSizes (91) => 128 heaps *
-		// 12K ~= 120K byte superblock.  Where 128-heap superblock handles a medium sized multi-processor server.
-		size_t remaining = heapMaster.heapManagersStorageEnd - heapMaster.heapManagersStorage; // remaining free heaps in superblock
-		if ( ! heapMaster.heapManagersStorage || remaining == 0 ) {
-			// Each block of heaps is a multiple of the number of cores on the computer.
-			int dimension = malloc_thread_extend();
-			size_t size = dimension * sizeof( Heap );
-
-			heapMaster.heapManagersStorage = (Heap *)mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
-			if ( UNLIKELY( heapMaster.heapManagersStorage == MAP_FAILED ) ) { // failed ?
-				if ( errno == ENOMEM ) abort( NO_MEMORY_MSG, size ); // no memory
-				// Do not call strerror( errno ) as it may call malloc.
-				abort( "**** Error **** attempt to allocate block of heaps of size %zu bytes and mmap failed with errno %d.", size, errno );
-			} // if
-			heapMaster.heapManagersStorageEnd = &heapMaster.heapManagersStorage[dimension]; // outside array
-		} // if
-
-		heap = heapMaster.heapManagersStorage;
-		heapMaster.heapManagersStorage = heapMaster.heapManagersStorage + 1; // bump next heap
-
-		#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
-		heap->nextHeapManager = heapMaster.heapManagersList;
-		heapMaster.heapManagersList = heap;
-		#endif // __STATISTICS__ || __DEBUG__
-
-		#ifdef __STATISTICS__
-		heapMaster.heapNew += 1;
-		#endif // __STATISTICS__
-
-		for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) { // initialize free lists
-			heap->freeLists[b] = (Heap::FreeHeader){
-				.freeList = nullptr,
-				.homeManager = heap,
-				.blockSize = bucketSizes[b],
-
-				#if defined( __STATISTICS__ )
-				.allocations = 0,
-				.reuses = 0,
-				#endif // __STATISTICS__
-
-				#ifdef __OWNERSHIP__
-				.remoteList = nullptr,
-				#endif // __OWNERSHIP__
-			};
-		} // for
-
-		heap->bufStart = nullptr;
-		heap->bufRemaining = 0;
-		heap->nextFreeHeapManager = nullptr;
-
-		#ifdef __DEBUG__
-		heap->allocUnfreed = 0;
-		#endif // __DEBUG__
+		heap = newHeap();
+		LLPROBE( heap_create, heap );
 	} // if
 
 	return heap;
 } // HeapMaster::getHeap
+#endif // ! __PERCPU__
 
 #define SETSPECIFIC() \
 	if ( pthread_setspecific( pthread_key, (void *)1 ) ) { /* key must be non-zero to trigger destructor */ \
@@ -735,10 +1760,16 @@ static void heapManagerCtor( void ) {
 
 	// get storage for heap manager
 
+	#ifdef __PERCPU__
+	heapManager = cpuHeap();							// reselected on each allocation and free
+	#else
 	heapManager = getHeap();
+	#endif // __PERCPU__
 
 	#ifdef __STATISTICS__
+	#ifndef __PERCPU__
 	HeapStatisticsCtor( heapManager->stats );			// heap local
+	#endif // ! __PERCPU__
 	heapMaster.threadsStarted += 1;
 	#endif // __STATISTICS__
 
@@ -769,6 +1800,9 @@ NOWARNING( __attribute__(( constructor( 100 ) )) static void startup( void ) {,
 	SETSPECIFIC();
 	heapMasterBootFlag = 2;								// program thread done initialization
 
+	// Load the unwinder, so backtraces of samples do not allocate.
+	if ( heapMaster.sampleRate != 0 ) { void * pc; backtrace( &pc, 1 ); }
+
 	#ifdef __DEBUG__
 	heapManager->allocUnfreed = 0;						// clear prior allocation counts
 	#endif // __DEBUG__
@@ -825,20 +1859,41 @@ static const char * prtfmt1[] = {
 	"  valloc    >0 calls %'llu; 0 calls %'llu; storage %'llu/%'llu bytes\n",
 	"  aligned_resize >0 calls %'llu; 0 calls %'llu; storage %'llu/%'llu bytes\n",
 	"  aligned_realloc >0 calls %'llu; 0 calls %'llu; storage %'llu/%'llu bytes\n",
+	"  new       >0 calls %'llu; 0 calls %'llu; storage %'llu/%'llu bytes\n",
+	"  aligned_new >0 calls %'llu; 0 calls %'llu; storage %'llu/%'llu bytes\n",
+	"  delete    !null calls %'llu; null/0 calls %'llu; storage %'llu/%'llu bytes\n",
 	"  free      !null calls %'llu; null/0 calls %'llu; storage %'llu/%'llu bytes\n",
 	"  remote    pushes %'llu; pulls %'llu; storage %'llu/%'llu bytes\n",
+	"  mcache    misses %'llu; hits %'llu; storage %'llu/%'llu bytes\n",
+	"  depot     spills %'llu; refills %'llu; storage %'llu/%'llu bytes\n",
 };
+// allocation APIs with request-size histograms
+static const char * sizeNames[] = {
+	"malloc", "aalloc", "calloc", "resize", "realloc", "", "memalign", "amemalign", "cmemalign",
+	"aligned_alloc", "posix_memalign", "valloc", "aligned_resize", "aligned_realloc", "new", "aligned_new",
+};
+static_assert( sizeof(sizeNames) / sizeof(sizeNames[0]) == HeapStatistics::DELETE, "missing request-size histogram name" );
+// slow paths with latency histograms
+static const char * slowNames[] = { "manager_extend", "master_extend", "mmap", "munmap", "remote_pull" };
+static_assert( sizeof(slowNames) / sizeof(slowNames[0]) == HeapStatistics::SLOW_PATHS, "missing slow-path histogram name" );
 // 3 fields
 static const char * prtfmt2[] = {
 	"  mmap      calls %'llu; storage %'llu/%'llu bytes\n",
+	"  realloc_mremap calls %'llu; storage %'llu/%'llu bytes\n",
 	"  munmap    calls %'llu; storage %'llu/%'llu bytes\n",
 };
 // 2/3 fields
 #define prtFmt3 \
 	"  blocks    contiguous %'llu; non-contiguous %'llu; fragment storage %'llu bytes\n" \
 	"  sbrk      calls %'llu; storage %'llu bytes\n" \
+	"  trim      calls %'llu; storage %'llu bytes\n" \
+	"  purge     calls %'llu; storage %'llu bytes\n" \
+	"  exit      calls %'llu; released %'llu bytes; donated %'llu bytes; reused chains %'llu\n" \
+	"  pages     hugetlb %'llu; THP advised %'llu; base %'llu\n" \
 	"  threads   started %'llu; exited %'llu\n" \
-	"  heaps     new %'llu; reused %'llu\n"
+	"  heaps     new %'llu; reused %'llu\n" \
+	"  explicit  created %'llu; destroyed %'llu; released %'llu bytes\n" \
+	"  slabs     pages %'llu; storage %'llu bytes\n"
 
 
 // Use "write" because streams may be shutdown when calls are made.
@@ -853,7 +1908,7 @@ static int printStats( HeapStatistics & stats, const char * title = "" ) { // se
 	tlen += write( heapMaster.stats_fd, helpText, len );
 
 	// 4 fields, print non-zero calls.
-	size_t boundary = CntTriples - 2;
+	size_t boundary = CntTriples - 3;
 	for ( size_t i = 0; i < boundary; i += 1 ) {
 		if ( stats.counters[i].calls ) {
 			len = snprintf( helpText, sizeof(helpText), prtfmt1[i],
@@ -875,14 +1930,79 @@ static int printStats( HeapStatistics & stats, const char * title = "" ) { // se
 	len = snprintf( helpText, sizeof(helpText), prtFmt3,
 		heapMaster.blkContig, heapMaster.blkNoncontig, heapMaster.blkFragstorage,
 		heapMaster.sbrkCalls, heapMaster.sbrkStorage,
+		heapMaster.trimCalls, heapMaster.trimStorage,
+		heapMaster.purgeCalls, heapMaster.purgeStorage,
+		heapMaster.exitCalls, heapMaster.exitReleased, heapMaster.exitDonated, heapMaster.donateReuses,
+		heapMaster.hugetlbPages, heapMaster.thpAdvisedPages, heapMaster.basePages,
 		heapMaster.threadsStarted, heapMaster.threadsExited,
-		heapMaster.heapNew, heapMaster.heapReused
+		heapMaster.heapNew, heapMaster.heapReused,
+		heapMaster.explicitCreated, heapMaster.explicitDestroyed, heapMaster.explicitReleased,
+		heapMaster.slabPages, heapMaster.slabStorage
 	);
 
 	tlen += write( heapMaster.stats_fd, helpText, len );
 
+	for ( unsigned int n = 0; n < __NUMA_NODES__ && heapMaster.numaNodes > 1; n += 1 ) {
+		if ( heapMaster.pools[n].blocks ) {
+			len = snprintf( helpText, sizeof(helpText), "  node %-4u blocks %'llu; storage %'llu bytes\n",
+							n, heapMaster.pools[n].blocks, heapMaster.pools[n].storage );
+			tlen += write( heapMaster.stats_fd, helpText, len );
+		} // if
+	} // for
+
+	// Request-size histograms, print non-zero bins.
+	len = snprintf( helpText, sizeof(helpText), "Request sizes: (largest-size-in-bin:requests)\n" );
+	tlen += write( heapMaster.stats_fd, helpText, len );
+	for ( unsigned int i = 0; i < HeapStatistics::DELETE; i += 1 ) {
+		const char * sep = nullptr;						// null => no bins printed
+		for ( unsigned int b = 0; b < SizeBins; b += 1 ) {
+		  if ( stats.sizes[i][b] == 0 ) continue;
+			if ( sep == nullptr ) {
+				len = snprintf( helpText, sizeof(helpText), "  %-9s", sizeNames[i] );
+				tlen += write( heapMaster.stats_fd, helpText, len );
+				sep = " ";
+			} // if
+			bool last = b == SizeBins - 1;				// last bin has no upper bound
+			len = snprintf( helpText, sizeof(helpText), "%s%s%'zu:%'llu", sep, last ? ">" : "",
+							sizeBinTop( last ? b - 1 : b ), stats.sizes[i][b] );
+			tlen += write( heapMaster.stats_fd, helpText, len );
+			sep = "; ";
+		} // for
+		if ( sep != nullptr ) tlen += write( heapMaster.stats_fd, "\n", 1 );
+	} // for
+
+	// Slow-path latency histograms, print non-zero bins. Page faults are counted for the paths that map storage.
+	len = snprintf( helpText, sizeof(helpText), "Slow paths: (largest-latency-in-bin:events)\n" );
+	tlen += write( heapMaster.stats_fd, helpText, len );
+	for ( unsigned int i = 0; i < HeapStatistics::SLOW_PATHS; i += 1 ) {
+		unsigned long long int events = 0;
+		for ( unsigned int b = 0; b < LatencyBins; b += 1 ) events += stats.latency[i][b];
+	  if ( events == 0 ) continue;
+		len = snprintf( helpText, sizeof(helpText), "  %-14s events %'llu; mean %'llu ns", slowNames[i], events, stats.latency_time[i] / events );
+		if ( i == HeapStatistics::MANAGER_EXTEND || i == HeapStatistics::MMAP_CALL ) {
+			len += snprintf( helpText + len, sizeof(helpText) - len, "; minor faults %'llu", stats.latency_faults[i] );
+		} // if
+		tlen += write( heapMaster.stats_fd, helpText, len );
+		const char * sep = "\n    ";
+		for ( unsigned int b = 0; b < LatencyBins; b += 1 ) {
+		  if ( stats.latency[i][b] == 0 ) continue;
+			bool last = b == LatencyBins - 1;			// last bin has no upper bound
+			unsigned long long int top = latencyBinTop( last ? b - 1 : b );
+			len = snprintf( helpText, sizeof(helpText), "%s%s%llu%s:%'llu", sep, last ? ">" : "",
+							top < 1'000 ? top : top < 1'000'000 ? top / 1'000 : top / 1'000'000,
+							top < 1'000 ? "ns" : top < 1'000'000 ? "us" : "ms", stats.latency[i][b] );
+			tlen += write( heapMaster.stats_fd, helpText, len );
+			sep = "; ";
+		} // for
+		tlen += write( heapMaster.stats_fd, "\n", 1 );
+	} // for
+	rusage usage;
+	getrusage( RUSAGE_SELF, &usage );
+	len = snprintf( helpText, sizeof(helpText), "  faults    minor %'ld; major %'ld (process)\n", usage.ru_minflt, usage.ru_majflt );
+	tlen += write( heapMaster.stats_fd, helpText, len );
+
 	if ( print_buckets ) {
-		len = snprintf( helpText, sizeof(helpText), "\nFree Bucket Usage: (bucket-size/allocations/reuses)\n" );
+		len = snprintf( helpText, sizeof(helpText), "\nFree Bucket Usage: (bucket-size/allocations/reuses/request/internal-fragmentation%%)\n" );
 		tlen += write( STDERR_FILENO, helpText, len );	// file might be closed
 	
 		size_t th = 0, subtotal = 0, total = 0;
@@ -892,10 +2012,13 @@ static int printStats( HeapStatistics & stats, const char * title = "" ) { // se
 			len = snprintf( helpText, sizeof(helpText), "Heap %'zd\n", th );
 			tlen += write( STDERR_FILENO, helpText, len ); // file might be closed
 			for ( size_t b = 0, c = 0; b < Heap::NoBucketSizes; b += 1 ) {
-				if ( heap->freeLists[b].allocations != 0 ) {
-					subtotal += heap->freeLists[b].blockSize * heap->freeLists[b].allocations;
-					len = snprintf( helpText, sizeof(helpText), "%'zd/%'zd/%'zd, ",
-									heap->freeLists[b].blockSize, heap->freeLists[b].allocations, heap->freeLists[b].reuses );
+				const Heap::FreeHeader & freeList = heap->freeLists[b];
+				if ( freeList.allocations + freeList.reuses != 0 ) {
+					subtotal += freeList.blockSize * freeList.allocations;
+					size_t used = freeList.blockSize * (freeList.allocations + freeList.reuses); // bucket storage handed out
+					len = snprintf( helpText, sizeof(helpText), "%'zd/%'zd/%'zd/%'zd/%.0f%%, ",
+									freeList.blockSize, freeList.allocations, freeList.reuses, freeList.request,
+									(double)(used - Min( freeList.request, used )) / used * 100.0 );
 					tlen += write( STDERR_FILENO, helpText, len ); // file might be closed
 					if ( ++c % Columns == 0 )
 						tlen += write( STDERR_FILENO, "\n", 1 ); // file might be closed
@@ -917,6 +2040,13 @@ static int printStats( HeapStatistics & stats, const char * title = "" ) { // se
 		} // for
 		len = snprintf( helpText, sizeof(helpText), "Total bucket storage %'zd\n", total );
 		tlen += write( STDERR_FILENO, helpText, len ); // file might be closed
+
+		// Size classes in use, for the size-class tuner (sizeclasses.cc) and MALLOC_SIZE_CLASSES.
+		tlen += write( STDERR_FILENO, "Size classes: ", 14 ); // file might be closed
+		for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) {
+			len = snprintf( helpText, sizeof(helpText), "%u%s", bucketSizes[b], b < Heap::NoBucketSizes - 1 ? ", " : "\n" );
+			tlen += write( STDERR_FILENO, helpText, len ); // file might be closed
+		} // for
 	} // if
 
 	pthread_mutex_unlock( &printlock );					// protect printing
@@ -924,10 +2054,6 @@ static int printStats( HeapStatistics & stats, const char * title = "" ) { // se
 } // printStats
 
 #define prtFmtXML \
-	"<malloc version=\"1\">\n" \
-	"<heap nr=\"0\">\n" \
-	"<sizes>\n" \
-	"</sizes>\n" \
 	"<total type=\"malloc\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"aalloc\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"calloc\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
@@ -942,18 +2068,45 @@ static int printStats( HeapStatistics & stats, const char * title = "" ) { // se
 	"<total type=\"valloc\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"aligned_resize\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"aligned_realloc\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
+	"<total type=\"new\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
+	"<total type=\"aligned_new\" >0 count=\"%'llu;\" 0 count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
+	"<total type=\"delete\" !null=\"%'llu;\" 0 null/0=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"free\" !null=\"%'llu;\" 0 null/0=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"remote\" pushes=\"%'llu;\" 0 pulls=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
+	"<total type=\"mcache\" misses=\"%'llu;\" 0 hits=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
+	"<total type=\"depot\" spills=\"%'llu;\" 0 refills=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"sbrk\" count=\"%'llu;\" size=\"%'llu\"/> bytes\n" \
+	"<total type=\"trim\" count=\"%'llu;\" size=\"%'llu\"/> bytes\n" \
+	"<total type=\"purge\" count=\"%'llu;\" size=\"%'llu\"/> bytes\n" \
+	"<total type=\"exit\" count=\"%'llu;\" released=\"%'llu;\" donated=\"%'llu;\" reused=\"%'llu\"/> bytes\n" \
+	"<total type=\"pages\" hugetlb=\"%'llu;\" thp_advised=\"%'llu;\" base=\"%'llu\"/>\n" \
 	"<total type=\"mmap\" count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
+	"<total type=\"realloc_mremap\" count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"munmap\" count=\"%'llu;\" size=\"%'llu/%'llu\"/> bytes\n" \
 	"<total type=\"blocks\" contiguous=\"%'llu;\" non-contiguous=\"%'llu;\" size=\"%'llu\"/> bytes\n" \
 	"<total type=\"threads\" started=\"%'llu;\" exited=\"%'llu\"/>\n" \
 	"<total type=\"heaps\" new=\"%'llu;\" reused=\"%'llu\"/>\n" \
-	"</malloc>"
+	"<total type=\"explicit\" created=\"%'llu;\" destroyed=\"%'llu;\" size=\"%'llu\"/> bytes\n" \
+	"<total type=\"slabs\" pages=\"%'llu;\" size=\"%'llu\"/> bytes\n"
 
 static int printStatsXML( HeapStatistics & stats, FILE * stream ) { // see malloc_info
-	char helpText[sizeof(prtFmtXML) + 1024];			// space for message and values
+	char helpText[sizeof(prtFmtXML) + 1024 + __NUMA_NODES__ * 128]; // space for message, values and nodes
+	int tlen = 0;
+
+	// Request-size histograms, print non-zero bins.
+	#define prtHeadXML "<malloc version=\"1\">\n<heap nr=\"0\">\n<sizes>\n"
+	tlen += write( fileno( stream ), prtHeadXML, sizeof(prtHeadXML) - 1 );
+	for ( unsigned int i = 0; i < HeapStatistics::DELETE; i += 1 ) {
+		for ( unsigned int b = 0; b < SizeBins; b += 1 ) {
+		  if ( stats.sizes[i][b] == 0 ) continue;
+			int len = snprintf( helpText, sizeof(helpText), "<size type=\"%s\" from=\"%zu\" to=\"%zu\" count=\"%'llu\"/>\n",
+								sizeNames[i], b == 0 ? 0 : sizeBinTop( b - 1 ) + 1, b < SizeBins - 1 ? sizeBinTop( b ) : SIZE_MAX,
+								stats.sizes[i][b] );
+			tlen += write( fileno( stream ), helpText, len );
+		} // for
+	} // for
+	tlen += write( fileno( stream ), "</sizes>\n", 9 );
+
 	int len = snprintf( helpText, sizeof(helpText), prtFmtXML,
 		stats.malloc_calls, stats.malloc_0_calls, stats.malloc_request, stats.malloc_alloc,
 		stats.aalloc_calls, stats.aalloc_0_calls, stats.aalloc_request, stats.aalloc_alloc,
@@ -969,16 +2122,35 @@ static int printStatsXML( HeapStatistics & stats, FILE * stream ) { // see mallo
 		stats.valloc_calls, stats.valloc_alloc_0_calls, stats.valloc_alloc_request, stats.valloc_alloc_alloc,
 		stats.aligned_resize_calls, stats.aligned_resize_0_calls, stats.aligned_resize_request, stats.aligned_resize_alloc,
 		stats.aligned_realloc_calls, stats.aligned_realloc_0_calls, stats.aligned_realloc_request, stats.aligned_realloc_alloc,
+		stats.new_calls, stats.new_0_calls, stats.new_request, stats.new_alloc,
+		stats.aligned_new_calls, stats.aligned_new_0_calls, stats.aligned_new_request, stats.aligned_new_alloc,
+		stats.delete_calls, stats.delete_null_0_calls, stats.delete_request, stats.delete_alloc,
 		stats.free_calls, stats.free_null_0_calls, stats.free_request, stats.free_alloc,
 		stats.remote_pushes, stats.remote_pulls, stats.remote_request, stats.remote_alloc,
+		stats.mmap_cache_misses, stats.mmap_cache_hits, stats.mmap_cache_request, stats.mmap_cache_alloc,
+		stats.depot_spills, stats.depot_refills, stats.depot_request, stats.depot_alloc,
 		heapMaster.sbrkCalls, heapMaster.sbrkStorage,
+		heapMaster.trimCalls, heapMaster.trimStorage,
+		heapMaster.purgeCalls, heapMaster.purgeStorage,
+		heapMaster.exitCalls, heapMaster.exitReleased, heapMaster.exitDonated, heapMaster.donateReuses,
+		heapMaster.hugetlbPages, heapMaster.thpAdvisedPages, heapMaster.basePages,
 		stats.mmap_calls, stats.mmap_request, stats.mmap_alloc,
+		stats.realloc_mremap_calls, stats.realloc_mremap_request, stats.realloc_mremap_alloc,
 		stats.munmap_calls, stats.munmap_request, stats.munmap_alloc,
 		heapMaster.blkContig, heapMaster.blkNoncontig, heapMaster.blkFragstorage,
 		heapMaster.threadsStarted, heapMaster.threadsExited,
-		heapMaster.heapNew, heapMaster.heapReused
+		heapMaster.heapNew, heapMaster.heapReused,
+		heapMaster.explicitCreated, heapMaster.explicitDestroyed, heapMaster.explicitReleased,
+		heapMaster.slabPages, heapMaster.slabStorage
 	);
-	return write( fileno( stream ), helpText, len );
+	for ( unsigned int n = 0; n < __NUMA_NODES__ && heapMaster.numaNodes > 1; n += 1 ) {
+		if ( heapMaster.pools[n].blocks ) {
+			len += snprintf( helpText + len, sizeof(helpText) - len, "<total type=\"node\" id=\"%u\" blocks=\"%'llu;\" size=\"%'llu\"/> bytes\n",
+							 n, heapMaster.pools[n].blocks, heapMaster.pools[n].storage );
+		} // if
+	} // for
+	len += snprintf( helpText + len, sizeof(helpText) - len, "</malloc>" );
+	return tlen + write( fileno( stream ), helpText, len );
 } // printStatsXML
 
 static HeapStatistics & collectStats( HeapStatistics & stats ) {
@@ -1028,7 +2200,37 @@ static inline __attribute__((always_inline)) bool setMmapStart( size_t value ) {
 // |header           |fake-header |addr
 #define HeaderAddr( addr ) ((Heap::Storage::Header *)( (char *)addr - sizeof(Heap::Storage) ))
 #define RealHeader( header ) ((Heap::Storage::Header *)((char *)header - header->kind.fake.offset))
-#define DataSize( bsize, addr, header ) (bsize - ( (char *)addr - (char *)header ))
+#define DataSize( bsize, addr, header ) (bsize - ( (char *)addr - (char *)header ) + (MmappedBit( header ) ? 0 : (size_t)HeaderOverlap))
+
+// Get and set the request size of an allocation from its real header and data address.
+#ifdef __COMPACT_HEADER__
+static inline __attribute__((always_inline)) size_t requestSize( Heap::Storage::Header * header, void * addr ) {
+  if ( UNLIKELY( MmappedBit( header ) ) ) return header->kind.real.size;
+	char * end = (char *)header + Home( header )->blockSize + HeaderOverlap; // end of data
+	size_t delta = header->kind.real.blockSize >> DeltaShift;
+  if ( UNLIKELY( delta == DeltaEscape ) ) return ((size_t *)end)[-1]; // escaped ?
+	return end - (char *)addr - delta;
+} // requestSize
+
+static inline __attribute__((always_inline)) void setRequestSize( Heap::Storage::Header * header, void * addr, size_t size ) {
+	if ( UNLIKELY( MmappedBit( header ) ) ) { header->kind.real.size = size; return; }
+	char * end = (char *)header + Home( header )->blockSize + HeaderOverlap; // end of data
+	size_t delta = end - ((char *)addr + size);
+	if ( UNLIKELY( delta >= DeltaEscape ) ) {			// escape ?
+		((size_t *)end)[-1] = size;						// store in unused bytes
+		delta = DeltaEscape;
+	} // if
+	header->kind.real.blockSize = (header->kind.real.blockSize & (((uintptr_t)1 << DeltaShift) - 1)) | delta << DeltaShift;
+} // setRequestSize
+#else
+static inline __attribute__((always_inline)) size_t requestSize( Heap::Storage::Header * header, void * ) {
+	return header->kind.real.size;
+} // requestSize
+
+static inline __attribute__((always_inline)) void setRequestSize( Heap::Storage::Header * header, void *, size_t size ) {
+	header->kind.real.size = size;
+} // setRequestSize
+#endif // __COMPACT_HEADER__
 
 
 #ifdef __DEBUG__
@@ -1041,13 +2243,21 @@ static inline __attribute__((always_inline)) void checkAlign( size_t alignment )
 
 static inline __attribute__((always_inline)) void checkHeader( bool check, const char name[], void * addr ) {
 	if ( UNLIKELY( check ) ) {							// bad address ?
-		abort( "**** Error **** attempt by thread %lx to %s storage %p outside the heap range %p<->%p.\n"
+		abort( "**** Error **** attempt by thread %lx to %s storage %p outside the heap.\n"
 			   "Possible cause is freeing stack storage or overwriting memory address.",
-			   pthread_self(), name, addr, heapMaster.sbrkStart, heapMaster.sbrkEnd );
+			   pthread_self(), name, addr );
 	} // if
 } // checkHeader
 #endif // __DEBUG__
 
+// Is addr in the current reservation of any NUMA pool ?
+static inline __attribute__(( unused )) bool inPools( void * addr ) {
+	for ( unsigned int n = 0; n < heapMaster.numaNodes; n += 1 ) {
+		if ( heapMaster.pools[n].sbrkStart <= addr && addr < heapMaster.pools[n].sbrkEnd ) return true;
+	} // for
+	return false;
+} // inPools
+
 
 static inline __attribute__((always_inline)) void fakeHeader( Heap::Storage::Header *& header, size_t & alignment ) {
 	if ( UNLIKELY( AlignmentBit( header ) ) ) {			// fake header ?
@@ -1069,7 +2279,7 @@ static inline __attribute__((always_inline)) bool headers( const char name[] __a
 	#endif // __DEBUG__
 
 	if ( LIKELY( ! StickyBits( header ) ) ) {			// no sticky bits ?
-		freeHead = header->kind.real.home;
+		freeHead = Home( header );
 		alignment = __ALIGN__;
 	} else {
 		fakeHeader( header, alignment );
@@ -1080,8 +2290,8 @@ static inline __attribute__((always_inline)) bool headers( const char name[] __a
 		} // if
 		#endif // __DEBUG__
 	if ( UNLIKELY( MmappedBit( header ) ) ) {			// mapped storage ?
-			assert( addr < heapMaster.sbrkStart || heapMaster.sbrkEnd < addr );
-			size = ClearStickyBits( header->kind.real.blockSize ); // mmap size
+			assert( ! inPools( addr ) );
+			size = MmappedSize( header );				// mmap size
 			freeHead = nullptr;							// prevent uninitialized warning
 			return true;
 		} // if
@@ -1098,7 +2308,7 @@ static inline __attribute__((always_inline)) bool headers( const char name[] __a
 			 // first grab correct heapManager vis-a-vis local or remote free, then freed?, and link points at a free block not to a bucket in the bucket array.
 			 ({ Heap::FreeHeader * temp = freeHead; heapManager == temp->homeManager && (temp < &heapManager->freeLists[0] || &heapManager->freeLists[Heap::NoBucketSizes] <= temp); }) ||
 			 // request size overwritten
-			 header->kind.real.size > freeHead->blockSize
+			 requestSize( header, addr ) > freeHead->blockSize
 			 )
 		) {
 		abort( "**** Error **** attempt by thread %lx to %s storage %p with corrupted header.\n"
@@ -1112,6 +2322,55 @@ static inline __attribute__((always_inline)) bool headers( const char name[] __a
 } // headers
 
 
+#ifndef __DEBUG__
+// Sized deallocation supplies the request alignment and size, so whether there is a fake header is known without
+// decoding the alignment bit. The mapped bit is still tested because realloc can shrink mapped storage below mmapStart
+// and mallopt can change mmapStart.
+static inline __attribute__((always_inline)) bool sizedHeaders( void * addr, bool fake,
+			Heap::Storage::Header *& header, Heap::FreeHeader *& freeHead, size_t & size ) {
+	header = HeaderAddr( addr );
+	if ( fake ) header = RealHeader( header );			// backup from fake to real header
+
+	if ( UNLIKELY( MmappedBit( header ) ) ) {			// mapped storage ?
+		size = MmappedSize( header );					// mmap size
+		freeHead = nullptr;								// prevent uninitialized warning
+		return true;
+	} // if
+
+	freeHead = ClearStickyBits( header->kind.real.home );
+	size = freeHead->blockSize;
+	return false;
+} // sizedHeaders
+#else
+
+// Check the size and alignment supplied to sized deallocation against the allocation. C23 requires the request size,
+// but C++ only requires a size within the allocation, as operator new can increase the request. As well,
+// malloc_usable_size resets the request size to the usable size.
+static void checkSized( const char name[], void * addr, size_t size, size_t alignment, bool exact ) {
+	Heap::Storage::Header * header;
+	Heap::FreeHeader * freeHead;
+	size_t bsize, halignment;
+
+	#ifdef __SLAB__
+	if ( SlabBlock( addr ) ) {							// request size is unknown
+		if ( UNLIKELY( size > SlabOf( addr )->blockSize || alignment != __ALIGN__ ) ) {
+			abort( "**** Error **** attempt by thread %lx to %s storage %p with size %zu and alignment %zu, but allocated with size <= %u and alignment %zu.",
+				   pthread_self(), name, addr, size, alignment, SlabOf( addr )->blockSize, (size_t)__ALIGN__ );
+		} // if
+		return;
+	} // if
+	#endif // __SLAB__
+
+	headers( name, addr, header, freeHead, bsize, halignment );
+	size_t rsize = requestSize( header, addr ), dsize = DataSize( bsize, addr, header );
+	if ( UNLIKELY( (size != rsize && (size > dsize || (exact && rsize != dsize))) || alignment != halignment ) ) {
+		abort( "**** Error **** attempt by thread %lx to %s storage %p with size %zu and alignment %zu, but allocated with size %zu and alignment %zu.",
+			   pthread_self(), name, addr, size, alignment, rsize, halignment );
+	} // if
+} // checkSized
+#endif // ! __DEBUG__
+
+
 #define MMAP_CHECK( addr ) \
 	if ( UNLIKELY( addr == MAP_FAILED ) ) { /* failed ? */ \
 		if ( errno == ENOMEM ) { pthread_mutex_unlock( &heapMaster.extLock ); return nullptr; }	/* no memory */ \
@@ -1121,23 +2380,77 @@ static inline __attribute__((always_inline)) bool headers( const char name[] __a
 	} /* if */
 
 // The following mimics an sbrk area but with multiple disjoint areas. The approach creates an empty address-space
-// (slab) that cannot be accessed (PROT_NONE). Then consecutive blocks of the address space are mmapped from it, until
+// (slab) that cannot be accessed (PROT_NONE). Then consecutive blocks of the address space are made accessible, until
 // the address space is full; the process then repeats with a another disjoint address space.  This approach works for
 // eager (QNX) and lazy (Linux) mapping of virtual memory. For example, the eager approach immediately creates the page
 // tables and zeros the pages, which results in a large latency bump for a large sbrk area. Hence, only the blocks are
-// mmap for access, subdividing the setup cost and spreading out the latency.
+// made accessible, subdividing the setup cost and spreading out the latency.
+//
+// In huge-page mode, the slab and its blocks are aligned on huge-page boundaries so the kernel can back each block
+// with huge pages, reducing TLB misses. Hugetlb blocks cannot be carved from the slab, so they are mapped separately.
+//
+// In NUMA mode, there is a slab per node, and a thread block is carved from the slab of the node the thread is running
+// on, with the block's pages preferably allocated on that node. With more nodes than slabs, nodes share a slab modulo
+// the number of slabs, so each block is bound to the node of its thread rather than the slab to a node.
+
+// Set the preferred node for the pages of storage, which the kernel honours when pages are first touched. Failure is
+// benign as the pages are then allocated on the node of the first toucher.
+static inline void numaBind( void * addr, size_t size, unsigned int node ) {
+	if ( heapMaster.numaNodes == 1 || heapMaster.numaEmulate ) return; // NUMA unaware or emulated nodes ?
+  if ( node >= sizeof(unsigned long int) * 8 ) return;	// node outside mask ?
+	enum { MPOL_PREFERRED = 1 };						// linux/mempolicy.h
+	unsigned long int mask = 1ul << node;
+	syscall( SYS_mbind, addr, size, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0 );
+} // numaBind
+
+static inline __attribute__((always_inline)) void * master_extend( size_t size, size_t align, unsigned int hugePages ) {
+	LLDEBUG( debugprt( "master_extend size %zd align %zd\n", size, align ) );
+	// With more OS nodes than pools, several nodes share a pool, so each thread block is bound to its OS node.
+	unsigned int node = 0;								// OS node
+	if ( UNLIKELY( heapMaster.numaNodes > 1 ) ) {		// NUMA aware ?
+		if ( heapMaster.numaEmulate ) {
+			node = syscall( SYS_gettid ) % heapMaster.numaNodes; // emulated node
+		} else {
+			syscall( SYS_getcpu, nullptr, &node, nullptr ); // node of current CPU
+		} // if
+	} // if
+	HeapMaster::Pool & pool = heapMaster.pools[node % heapMaster.numaNodes];
+	LLPROBE( master_extend, heapManager, size, node );
 
-static inline __attribute__((always_inline)) void * master_extend( size_t size ) {
-	LLDEBUG( debugprt( "master_extend size %zd\n", size ) );
 	pthread_mutex_lock( &heapMaster.extLock );
+	#ifdef __STATISTICS__
+	unsigned long long int start = cycleCount();		// time holding the lock
+	#endif // __STATISTICS__
+
+	if ( UNLIKELY( hugePages == HugetlbPages ) ) {		// hugetlb pages ?
+		void * newblock = ::mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+		if ( newblock != MAP_FAILED ) {					// otherwise huge-page pool exhausted => transparent huge pages
+			numaBind( newblock, size, node );
+			#ifdef __STATISTICS__
+			heapMaster.hugetlbPages += size / heapMaster.hugePageSize;
+			pool.blocks += 1;
+			pool.storage += size;
+			slowPath( heapManager->stats, HeapStatistics::MASTER_EXTEND, start );
+			#endif // __STATISTICS__
+			pthread_mutex_unlock( &heapMaster.extLock );
+			return newblock;
+		} // if
+	} // if
 
-	ptrdiff_t rem = heapMaster.sbrkRemaining - size;
+	// Skip the inaccessible storage to the next alignment boundary.
+	char * newblock = (char *)Ceiling( (uintptr_t)pool.sbrkEnd, align );
+	ptrdiff_t rem = pool.sbrkRemaining - (newblock - (char *)pool.sbrkEnd) - size;
 	if ( UNLIKELY( rem < 0 ) ) {						// negative ?
 		// If the size requested is bigger than the current remaining storage, increase the size of the heap.
-		size_t increase = Ceiling( Max( size, heapMaster.sbrkExtend ), __ALIGN__ );
-		Heap::Storage * block = (Heap::Storage *)::mmap( 0, heapMaster.sbrkExtend, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ); // cannot be accessed
+		size_t increase = Ceiling( Max( size, heapMaster.sbrkExtend ), align );
+		// Over-reserve by the alignment and release the excess at each end to align the slab.
+		size_t reserve = increase + (align > heapMaster.pageSize ? align : 0);
+		char * block = (char *)::mmap( 0, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ); // cannot be accessed
 		MMAP_CHECK( block );
-		heapMaster.sbrkStart = heapMaster.sbrkEnd = block;
+		newblock = (char *)Ceiling( (uintptr_t)block, align );
+		if ( newblock != block ) munmap( block, newblock - block );
+		if ( block + reserve != newblock + increase ) munmap( newblock + increase, block + reserve - (newblock + increase) );
+		pool.sbrkStart = newblock;
 		rem = increase - size;
 
 		#ifdef __STATISTICS__
@@ -1146,28 +2459,82 @@ static inline __attribute__((always_inline)) void * master_extend( size_t size )
 		#endif // __STATISTICS__
 	} // if
 
-	void * newblock = (Heap::Storage *)::mmap( heapMaster.sbrkEnd, Max( size, heapMaster.sbrkThreadBlock ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
-	MMAP_CHECK( newblock );
-	heapMaster.sbrkRemaining = rem;
-	heapMaster.sbrkEnd = (char *)heapMaster.sbrkEnd + size;
+	// Changing the protection, rather than mapping over the slab, leaves the slab intact if there is no memory.
+	if ( UNLIKELY( mprotect( newblock, size, PROT_READ | PROT_WRITE ) == -1 ) ) {
+		if ( errno == ENOMEM ) { pthread_mutex_unlock( &heapMaster.extLock ); return nullptr; } // no memory
+		// Do not call strerror( errno ) as it may call malloc.
+		abort( "**** Error **** attempt to extend heap by %zu bytes and mprotect failed with errno %d.", size, errno );
+	} // if
+	numaBind( newblock, size, node );					// before first touch
+
+	if ( hugePages != NoHugePages ) {					// transparent huge pages ?
+		// Advice only, as the kernel may not support or may disable transparent huge pages.
+		madvise( newblock, size, MADV_HUGEPAGE );
+		#ifdef __STATISTICS__
+		heapMaster.thpAdvisedPages += size / heapMaster.hugePageSize;
+	} else {
+		heapMaster.basePages += size / heapMaster.pageSize;
+		#endif // __STATISTICS__
+	} // if
+
+	pool.sbrkRemaining = rem;
+	pool.sbrkEnd = newblock + size;
+	#ifdef __STATISTICS__
+	pool.blocks += 1;
+	pool.storage += size;
+	slowPath( heapManager->stats, HeapStatistics::MASTER_EXTEND, start );
+	#endif // __STATISTICS__
 
 	pthread_mutex_unlock( &heapMaster.extLock );
 	return newblock;
 } // master_extend
 
 
+// Map an extent of size bytes for an explicit heap and link it into the heap. Returns the storage after the extent
+// header, or nullptr if there is no memory.
+static void * extentMap( Heap * heap, size_t size ) {
+	Heap::Extent * extent = (Heap::Extent *)::mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( UNLIKELY( extent == MAP_FAILED ) ) {			// failed ?
+	  if ( errno == ENOMEM ) return nullptr;			// no memory
+		// Do not call strerror( errno ) as it may call malloc.
+		abort( "**** Error **** attempt to allocate explicit-heap extent of size %zu bytes and mmap failed with errno %d.", size, errno );
+	} // if
+	extent->size = size;
+	extent->prev = nullptr;
+	extent->next = heap->extents;
+	if ( heap->extents != nullptr ) heap->extents->prev = extent;
+	heap->extents = extent;
+	return extent + 1;
+} // extentMap
+
+
+static void heapDecay( Heap * heap );					// forward
+
 static void * manager_extend( size_t size ) {
 	LLDEBUG( debugprt( "manager_extend size %zd\n", size ) );
+	heapDecay( heapManager );							// release idle storage before reserving more
+	#ifdef __STATISTICS__
+	unsigned long long int faults = minorFaults(), start = cycleCount();
+	#endif // __STATISTICS__
 	// If the size requested is > the current remaining reserve => increase the reserve.
 	size_t tblock = malloc_thread_block();
-	size_t increase = Ceiling( Max( size, tblock ), __ALIGN__ );
-	void * newblock = master_extend( increase );
+	size_t increase;
+	void * newblock;
+	if ( UNLIKELY( heapManager->explicitHeap ) ) {		// explicit heap ? => extent released by heap_destroy
+		increase = Ceiling( Max( size + HeaderOverlap + sizeof(Heap::Extent), tblock ), heapMaster.pageSize ) - sizeof(Heap::Extent);
+		newblock = extentMap( heapManager, increase + sizeof(Heap::Extent) );
+	} else {
+		unsigned int hugePages = heapMaster.hugePages;	// read once as mallopt can change it
+		size_t align = hugePages == NoHugePages ? heapMaster.pageSize : heapMaster.hugePageSize;
+		increase = Ceiling( Max( size + HeaderOverlap, tblock ), align );
+		newblock = master_extend( increase, align, hugePages );
+	} // if
 
   if ( UNLIKELY( newblock == nullptr ) ) return nullptr; // no memory ?
 
 	// Check if the new reserve block is contiguous with the old block (The only good storage is contiguous storage!)
 	// For sequential programs, this check is always true.
-	if ( newblock != (char *)heapManager->bufStart + heapManager->bufRemaining ) { // not contiguous ?
+	if ( newblock != (char *)heapManager->bufStart + heapManager->bufRemaining + HeaderOverlap ) { // not contiguous ?
 		// Otherwise, find the closest bucket size to the remaining storage in the reserve block and chain it onto
 		// that free list. Distributing the storage across multiple free lists is an option but takes time.
 		ptrdiff_t rem = heapManager->bufRemaining;		// positive
@@ -1178,20 +2545,23 @@ static void * manager_extend( size_t size ) {
 		heapMaster.blkFragstorage += rem;
 		#endif // __STATISTICS__
 
-		if ( (decltype(bucketSizes[0]))rem >= bucketSizes[0] ) { // minimal size ? otherwise ignore
-			Heap::FreeHeader * freeHead =
-			#ifdef __FASTLOOKUP__
-				rem < LookupSizes ? &(heapManager->freeLists[lookup[rem]]) :
-			#endif // __FASTLOOKUP__
-				&(heapManager->freeLists[Bsearchl( rem, bucketSizes, heapMaster.maxBucketsUsed )]); // binary search
+		if ( (size_t)rem >= bucketSizes[0] ) { // minimal size ? otherwise ignore
+			Heap::FreeHeader * freeHead = &(heapManager->freeLists[bucketIndex( rem )]);
 
 			// The remaining storage may not be bucket size, whereas all other allocations are. Round down to previous
 			// bucket size in this case.
 			if ( UNLIKELY( freeHead->blockSize > (size_t)rem ) ) freeHead -= 1;
 			Heap::Storage * block = (Heap::Storage *)heapManager->bufStart;
 
+			#ifdef __PERCPU__
+			freeListPush( heapManager, freeHead - heapManager->freeLists, block, block );
+			#else
 			block->header.kind.real.next = freeHead->freeList; // push on stack
 			freeHead->freeList = block;
+			#ifdef __DEPOT__
+			freeHead->freeCount += 1;
+			#endif // __DEPOT__
+			#endif // __PERCPU__
 		} // if
 	#ifdef __STATISTICS__
 	} else {
@@ -1199,29 +2569,441 @@ static void * manager_extend( size_t size ) {
 	#endif // __STATISTICS__
 	} // if
 
-	heapManager->bufRemaining = increase - size;
+	heapManager->bufRemaining = increase - size - HeaderOverlap;
 	heapManager->bufStart = (char *)newblock + size;
+	LLPROBE( manager_extend, heapManager, size, increase );
+	#ifdef __STATISTICS__
+	slowPath( heapManager->stats, HeapStatistics::MANAGER_EXTEND, start, faults );
+	#endif // __STATISTICS__
 	return newblock;
 } // manager_extend
 
 
-#ifdef __STATISTICS__
-#define STAT_NAME __counter
-#define STAT_PARM , unsigned int STAT_NAME
-#define STAT_ARG( name ) , name
-#define STAT_0_CNT( counter ) heapManager->stats.counters[counter].calls_0 += 1
-#else
-#define STAT_NAME
-#define STAT_PARM
-#define STAT_ARG( name )
-#define STAT_0_CNT( counter )
-#endif // __STATISTICS__
+static inline __attribute__((always_inline)) unsigned long long int monotonicTime( void ) { // nanoseconds
+	timespec t;
+	clock_gettime( CLOCK_MONOTONIC_COARSE, &t );		// low resolution is sufficient
+	return t.tv_sec * 1'000'000'000ULL + t.tv_nsec;
+} // monotonicTime
+
+
+static void unmap( void * addr, size_t size ) {
+	if ( UNLIKELY( munmap( addr, size ) == -1 ) ) {
+		// Do not call strerror( errno ) as it may call malloc.
+		abort( "**** Error **** attempt to deallocate large object %p and munmap failed with errno %d.\n"
+			   "Possible cause is invalid delete pointer: either not allocated or with corrupt header.",
+			   addr, errno );
+	} // if
+} // unmap
+
+
+// Unlink an extent of an explicit heap and return its storage to the OS.
+static void extentUnmap( Heap * heap, Heap::Extent * extent ) {
+	if ( extent->prev != nullptr ) extent->prev->next = extent->next;
+	else heap->extents = extent->next;
+	if ( extent->next != nullptr ) extent->next->prev = extent->prev;
+	unmap( extent, extent->size );
+} // extentUnmap
+
+
+// Large allocations are mapped and unmapped directly from the OS, costing two system calls plus page faults to zero
+// fill the storage. To amortize these costs, freed mappings are retained in a small global cache, bounded by number
+// and storage, and reused by subsequent large allocations of a compatible size. As there are few slots and the
+// system call dominates, a linear best-fit search is sufficient. Reused mappings are not zero filled.
+
+// Remove a cached mapping whose size is within 25% above size, and return it with its size or nullptr.
+static Heap::Storage * mmapCacheGet( size_t & size ) {
+	pthread_mutex_lock( &heapMaster.mmapCacheLock );
+	size_t best = heapMaster.mmapCacheCnt;
+	for ( size_t i = 0; i < heapMaster.mmapCacheCnt; i += 1 ) {
+		size_t csize = heapMaster.mmapCache[i].size;
+		if ( size <= csize && csize - size <= size / 4 && // compatible ?
+			 ( best == heapMaster.mmapCacheCnt || csize < heapMaster.mmapCache[best].size ) ) best = i; // better fit ?
+	} // for
+
+	Heap::Storage * block = nullptr;
+	if ( best != heapMaster.mmapCacheCnt ) {			// found ?
+		block = heapMaster.mmapCache[best].block;
+		size = heapMaster.mmapCache[best].size;
+		heapMaster.mmapCacheStorage -= size;
+		heapMaster.mmapCacheCnt -= 1;
+		heapMaster.mmapCache[best] = heapMaster.mmapCache[heapMaster.mmapCacheCnt]; // fill hole with last slot
+	} // if
+	pthread_mutex_unlock( &heapMaster.mmapCacheLock );
+	return block;
+} // mmapCacheGet
+
+// Remove cached mapping i and return its storage to the OS. The caller must hold the cache lock.
+static size_t mmapCacheEvict( size_t i ) {
+	size_t size = heapMaster.mmapCache[i].size;
+	unmap( heapMaster.mmapCache[i].block, size );
+	heapMaster.mmapCacheStorage -= size;
+	heapMaster.mmapCacheCnt -= 1;
+	heapMaster.mmapCache[i] = heapMaster.mmapCache[heapMaster.mmapCacheCnt]; // fill hole with last slot
+	return size;
+} // mmapCacheEvict
+
+// Return to the OS the cached mappings cached before time, and return the storage released.
+static size_t mmapCacheRelease( unsigned long long int time ) {
+	size_t released = 0;
+	pthread_mutex_lock( &heapMaster.mmapCacheLock );
+	for ( size_t i = 0; i < heapMaster.mmapCacheCnt; ) {
+		if ( heapMaster.mmapCache[i].time < time ) released += mmapCacheEvict( i ); // slot i refilled
+		else i += 1;
+	} // for
+	pthread_mutex_unlock( &heapMaster.mmapCacheLock );
+	return released;
+} // mmapCacheRelease
+
+// Cache a freed mapping, evicting the oldest mappings to make room, and return false if the mapping is not cached.
+static bool mmapCachePut( Heap::Storage * block, size_t size ) {
+	size_t max = heapMaster.mmapCacheMax;				// read once as mallopt can change it
+  if ( size > max ) return false;						// too large or no cache ?
+	unsigned long long int now = monotonicTime();
+
+	pthread_mutex_lock( &heapMaster.mmapCacheLock );
+	// The cached storage can exceed max after mallopt shrinks the cache, so evict until the mapping fits.
+	while ( heapMaster.mmapCacheCnt == __MMAP_CACHE_SLOTS__ || heapMaster.mmapCacheStorage + size > max ) {
+		size_t oldest = 0;
+		for ( size_t i = 1; i < heapMaster.mmapCacheCnt; i += 1 ) {
+			if ( heapMaster.mmapCache[i].time < heapMaster.mmapCache[oldest].time ) oldest = i;
+		} // for
+		mmapCacheEvict( oldest );
+	} // while
+	heapMaster.mmapCache[heapMaster.mmapCacheCnt] = { block, size, now };
+	heapMaster.mmapCacheCnt += 1;
+	heapMaster.mmapCacheStorage += size;
+	pthread_mutex_unlock( &heapMaster.mmapCacheLock );
+	return true;
+} // mmapCachePut
+
+
+// The request-size field of a freed block is unused until the block is reallocated, so it records the state of a free
+// block with respect to returning its storage to the OS. Reallocation overwrites the state.
+#ifdef __COMPACT_HEADER__
+#define FreeState( block ) (*(size_t *)(block)->data)	// request-size field is data of the previous block
+#else
+#define FreeState( block ) ((block)->header.kind.real.size)
+#endif // __COMPACT_HEADER__
+enum : size_t {
+	TRIMMED = UNDEFINED,								// interior pages of free block are returned to the OS
+	AGED = UNDEFINED - 1,								// free block is unused since the last decay check
+}; // enum
+
+// Return to the OS the whole pages spanned by the free blocks of a heap, after retaining pad bytes of free storage.
+// The block header and the partial pages at each end of a block stay mapped, so the free-list links are unaffected
+// and the released pages are transparently zero filled when the block is reused. For decay, only blocks unused since
+// the previous decay check are released, and the others are marked for the next check. The caller must own the heap
+// or hold mgrLock for a heap on the free-heap stack. A CPU heap's free lists are detached while trimming.
+static size_t heapTrim( Heap * heap, size_t & pad, bool decay = false ) {
+	size_t released = 0;
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) {
+		Heap::FreeHeader * freeHead = &heap->freeLists[b];
+	  if ( freeHead->blockSize <= heapMaster.pageSize ) continue; // block cannot span a page ?
+
+		#ifdef __OWNERSHIP__
+		if ( freeHead->remoteList ) remotePull( heap, freeHead ); // returned space ?
+		#endif // __OWNERSHIP__
+
+		#ifdef __PERCPU__
+		Heap::Storage * list = freeListPopAll( heap, b ), * last = nullptr;
+		#else
+		Heap::Storage * list = freeHead->freeList;
+		#endif // __PERCPU__
+
+		for ( Heap::Storage * block = list; block != nullptr; block = block->header.kind.real.next ) {
+			#ifdef __PERCPU__
+			last = block;
+			#endif // __PERCPU__
+			size_t & state = FreeState( block );
+		  if ( state == TRIMMED ) continue;				// already released ?
+		  if ( decay && state != AGED ) { state = AGED; continue; } // freed since last decay check ?
+		  if ( pad >= freeHead->blockSize ) { pad -= freeHead->blockSize; continue; } // retain storage ?
+			pad = 0;
+			char * start = (char *)Ceiling( (uintptr_t)(&state + 1), heapMaster.pageSize );
+			char * end = (char *)Floor( (uintptr_t)block + freeHead->blockSize, heapMaster.pageSize );
+			if ( start < end && madvise( start, end - start, MADV_DONTNEED ) == 0 ) {
+				state = TRIMMED;
+				released += end - start;
+			} // if
+		} // for
+
+		#ifdef __PERCPU__
+		if ( list != nullptr ) freeListPush( heap, b, list, last ); // reattach
+		#endif // __PERCPU__
+	} // for
+	return released;
+} // heapTrim
+
+
+#ifdef __PERCPU__
+// Trim the CPU heaps, returning the number of bytes released. With rseq, the free-list operations apply to the current
+// CPU's heap, so the thread migrates in turn to each CPU in its affinity mask to trim that CPU's heap, and then restores
+// its mask. The heaps of CPUs outside the mask are not trimmed, as the thread must not run there, e.g., on isolated
+// cores; their free storage is released by decay. Otherwise, all CPU heaps are trimmed under their list locks.
+static size_t cpuHeapsTrim( size_t & pad ) {
+	size_t released = 0;
+	if ( ! heapMaster.rseq ) {
+		for ( unsigned int c = 0; c < heapMaster.cpus; c += 1 ) {
+			released += heapTrim( &heapMaster.cpuHeaps[c], pad );
+		} // for
+		return released;
+	} // if
+
+	cpu_set_t affinity, cpu;
+	if ( sched_getaffinity( 0, sizeof(affinity), &affinity ) != 0 ) {
+		return heapTrim( cpuHeap(), pad );				// current CPU only
+	} // if
+	for ( unsigned int c = 0; c < heapMaster.cpus && c < CPU_SETSIZE; c += 1 ) {
+	  if ( ! CPU_ISSET( c, &affinity ) ) continue;		// thread must not run on CPU ?
+		CPU_ZERO( &cpu );
+		CPU_SET( c, &cpu );
+	  if ( sched_setaffinity( 0, sizeof(cpu), &cpu ) != 0 ) continue; // CPU offline ?
+		released += heapTrim( cpuHeap(), pad );
+	} // for
+	if ( UNLIKELY( sched_setaffinity( 0, sizeof(affinity), &affinity ) != 0 ) ) { // restore
+		// The CPUs of the mask went offline meanwhile, so, like the kernel, allow any CPU of the thread's cpuset.
+		for ( unsigned int c = 0; c < CPU_SETSIZE; c += 1 ) CPU_SET( c, &affinity );
+		if ( sched_setaffinity( 0, sizeof(affinity), &affinity ) != 0 ) {
+			// Do not call strerror( errno ) as it may call malloc.
+			abort( "**** Error **** malloc_trim cannot restore the thread's CPU affinity, errno %d.", errno );
+		} // if
+	} // if
+	return released;
+} // cpuHeapsTrim
+#endif // __PERCPU__
+
+
+#ifndef __PERCPU__										// CPU heaps are shared, so they never exit
+// Apply the exit policy to the heap of a terminating thread, which owns the heap until it is pushed on the free-heap
+// stack.
+static void heapExit( Heap * heap, unsigned int policy ) {
+	#ifdef __OWNERSHIP__
+	if ( policy & (ExitDrain | ExitDonate) ) {			// drain remote lists ?
+		for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) {
+			if ( heap->freeLists[b].remoteList ) remotePull( heap, &heap->freeLists[b] );
+		} // for
+	} // if
+	#endif // __OWNERSHIP__
+
+	size_t released = 0, donated = 0;
+	if ( policy & ExitTrim ) {							// release free pages ?
+		size_t pad = 0;
+		released = heapTrim( heap, pad );
+		char * start = (char *)Ceiling( (uintptr_t)heap->bufStart + HeaderOverlap, heapMaster.pageSize );
+		char * end = (char *)Floor( (uintptr_t)heap->bufStart + heap->bufRemaining, heapMaster.pageSize );
+		if ( start < end && madvise( start, end - start, MADV_DONTNEED ) == 0 ) released += end - start;
+	} // if
+
+	if ( policy & ExitDonate ) {						// donate free storage ?
+		pthread_mutex_lock( &heapMaster.donateLock );
+		for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) {
+			Heap::FreeHeader * freeHead = &heap->freeLists[b];
+		  if ( freeHead->freeList == nullptr ) continue;
+			Heap::Storage * last = freeHead->freeList;
+			for ( donated += freeHead->blockSize; last->header.kind.real.next; last = last->header.kind.real.next ) {
+				donated += freeHead->blockSize;
+			} // for
+			last->header.kind.real.next = heapMaster.donated[b]; // chain onto donated storage
+			heapMaster.donated[b] = freeHead->freeList;
+			freeHead->freeList = nullptr;
+			#ifdef __DEPOT__
+			freeHead->freeCount = 0;
+			#endif // __DEPOT__
+		} // for
+
+		// Donate the buffer as a block of the closest smaller bucket size, as for a non-contiguous extension.
+		if ( heap->bufRemaining >= bucketSizes[0] ) {
+			size_t b = Bsearchl( heap->bufRemaining, bucketSizes, heapMaster.maxBucketsUsed );
+			if ( bucketSizes[b] > heap->bufRemaining ) b -= 1;
+			Heap::Storage * block = (Heap::Storage *)heap->bufStart;
+			block->header.kind.real.next = heapMaster.donated[b];
+			heapMaster.donated[b] = block;
+			donated += heap->bufRemaining;
+			heap->bufStart = nullptr;
+			heap->bufRemaining = 0;
+		} // if
+		pthread_mutex_unlock( &heapMaster.donateLock );
+	} // if
+
+	#ifdef __STATISTICS__
+	Fai( heapMaster.exitCalls, 1 );
+	Fai( heapMaster.exitReleased, released );
+	Fai( heapMaster.exitDonated, donated );
+	#endif // __STATISTICS__
+} // heapExit
+
+
+// Take the donated chain for a bucket, returning its first block and making the remainder the free list.
+static Heap::Storage * donateGet( Heap * heap, Heap::FreeHeader * freeHead ) {
+	size_t b = freeHead - heap->freeLists;
+	pthread_mutex_lock( &heapMaster.donateLock );
+	Heap::Storage * block = heapMaster.donated[b];
+	heapMaster.donated[b] = nullptr;
+	pthread_mutex_unlock( &heapMaster.donateLock );
+  if ( block == nullptr ) return nullptr;				// lost race ?
+	freeHead->freeList = block->header.kind.real.next;	// free list is empty
+
+	#ifdef __STATISTICS__
+	Fai( heapMaster.donateReuses, 1 );
+	#endif // __STATISTICS__
+	return block;
+} // donateGet
+#endif // ! __PERCPU__
+
+
+#ifdef __DEPOT__
+// Push the chain of batches first to last onto a bucket's depot stack.
+static void depotPush( Heap::Storage *& top, Heap::Storage * first, Heap::Storage * last ) {
+	Heap::Storage * temp;
+	do {
+		temp = top;
+		FreeState( last ) = (uintptr_t)temp;			// link batches
+	} while ( ! Cas( top, temp, first ) );
+} // depotPush
+
+
+// Spill a batch from the top of a bucket's free list onto the global depot. The bucket has more than a batch of free
+// blocks, because the free count never exceeds the list length.
+static void depotSpill( Heap * heap, Heap::FreeHeader * freeHead ) {
+	Heap::Storage * batch = freeHead->freeList, * last = batch;
+	for ( unsigned int i = 1; i < freeHead->depotBatch; i += 1 ) last = last->header.kind.real.next;
+	freeHead->freeList = last->header.kind.real.next;
+	last->header.kind.real.next = nullptr;				// terminate batch
+	freeHead->freeCount -= freeHead->depotBatch;
+
+	depotPush( heapMaster.depot[freeHead - heap->freeLists].top, batch, batch );
+
+	#ifdef __STATISTICS__
+	StatAdd( heap->stats.depot_spills, 1 );
+	StatAdd( heap->stats.depot_request, freeHead->depotBatch * freeHead->blockSize );
+	#endif // __STATISTICS__
+} // depotSpill
+
+
+// Refill an empty bucket with a batch from the global depot, returning its first block and making the remainder the
+// free list. The stack is removed with an exchange, so no popped batch can reappear during the removal (no ABA), and
+// the remaining batches are pushed back.
+static Heap::Storage * depotRefill( Heap * heap, Heap::FreeHeader * freeHead ) {
+	Heap::Storage *& top = heapMaster.depot[freeHead - heap->freeLists].top;
+	Heap::Storage * batch = Fas( top, nullptr );
+  if ( batch == nullptr ) return nullptr;				// lost race ?
+	if ( Heap::Storage * rest = (Heap::Storage *)FreeState( batch ); rest != nullptr ) {
+		if ( ! Cas( top, (Heap::Storage *)nullptr, rest ) ) {			// batches spilled meanwhile ?
+			Heap::Storage * last = rest;
+			while ( FreeState( last ) != 0 ) last = (Heap::Storage *)FreeState( last );
+			depotPush( top, rest, last );
+		} // if
+	} // if
+
+	freeHead->freeList = batch->header.kind.real.next; // free list is empty
+	freeHead->freeCount = freeHead->depotBatch - 1;
+
+	#ifdef __STATISTICS__
+	StatAdd( heap->stats.depot_refills, 1 );
+	StatAdd( heap->stats.depot_alloc, freeHead->depotBatch * freeHead->blockSize );
+	#endif // __STATISTICS__
+	return batch;
+} // depotRefill
+
+
+// Return to the OS the whole pages spanned by the blocks in the global depot, after retaining pad bytes of free storage.
+// A bucket's stack is removed with an exchange, so its batches are private while trimmed, and then pushed back. The
+// first block of a batch holds the batch link in its state field, so only the blocks after it are marked as trimmed.
+static size_t depotTrim( size_t & pad ) {
+	size_t released = 0;
+	for ( size_t b = 0; b < Heap::NoBucketSizes; b += 1 ) {
+		size_t blockSize = bucketSizes[b];
+	  if ( blockSize <= heapMaster.pageSize ) continue;	// block cannot span a page ?
+		Heap::Storage *& top = heapMaster.depot[b].top;
+	  if ( top == nullptr ) continue;					// no batches ?
+		Heap::Storage * first = Fas( top, nullptr ), * last = nullptr;
+
+		for ( Heap::Storage * batch = first; batch != nullptr; batch = (Heap::Storage *)FreeState( batch ) ) {
+			last = batch;
+			for ( Heap::Storage * block = batch; block != nullptr; block = block->header.kind.real.next ) {
+				size_t & state = FreeState( block );
+			  if ( block != batch && state == TRIMMED ) continue; // already released ?
+			  if ( pad >= blockSize ) { pad -= blockSize; continue; } // retain storage ?
+				pad = 0;
+				char * start = (char *)Ceiling( (uintptr_t)(&state + 1), heapMaster.pageSize );
+				char * end = (char *)Floor( (uintptr_t)block + blockSize, heapMaster.pageSize );
+				if ( start < end && madvise( start, end - start, MADV_DONTNEED ) == 0 ) {
+					if ( block != batch ) state = TRIMMED;
+					released += end - start;
+				} // if
+			} // for
+		} // for
+
+		if ( first != nullptr ) depotPush( top, first, last ); // reattach
+	} // for
+	return released;
+} // depotTrim
+#endif // __DEPOT__
+
+
+// Return free storage idle for a decay period to the OS. A block freed before one check and still free at the next
+// check, at least a decay period later, is released. Called by the owner thread every __PURGE_TICKS__ frees, and on the
+// allocation slow paths, so a heap that stops freeing locally is still checked when it extends or drains remote frees.
+static void heapDecay( Heap * heap ) {
+  if ( LIKELY( heapMaster.purgeDecay == 0 ) ) return;	// decay disabled ?
+
+	unsigned long long int now = monotonicTime(), prev = heap->purgeTime;
+  if ( now - prev < heapMaster.purgeDecay ) return;	// decay period not elapsed ?
+	#ifdef __PERCPU__
+  if ( ! Cas( heap->purgeTime, prev, now ) ) return;	// another thread on the CPU is checking ?
+	#else
+	heap->purgeTime = now;
+	#endif // __PERCPU__
+
+	size_t pad = 0;
+	size_t released __attribute__(( unused )) = heapTrim( heap, pad, true );
+	if ( heapMaster.mmapCacheCnt != 0 ) released += mmapCacheRelease( now - heapMaster.purgeDecay ); // aged mappings
+
+	#ifdef __STATISTICS__
+	Fai( heapMaster.purgeCalls, 1 );
+	Fai( heapMaster.purgeStorage, released );
+	#endif // __STATISTICS__
+} // heapDecay
+
+// Called by a thread every __PURGE_TICKS__ frees, local or remote, to reclaim returned storage and check for decay.
+static void heapPurge( Heap * heap ) {
+	#ifdef __PERCPU__
+	Fas( heap->purgeTick, __PURGE_TICKS__ );			// reset amortization counter
+	#else
+	heap->purgeTick = __PURGE_TICKS__;					// reset amortization counter
+	#endif // __PERCPU__
+
+	#ifdef __OWNERSHIP__
+	if ( heap->remotePending != 0 ) remoteDrain( heap ); // periodically reclaim returned storage
+	#endif // __OWNERSHIP__
+	heapDecay( heap );
+} // heapPurge
+
+
+#ifdef __STATISTICS__
+#define STAT_NAME __counter
+#define STAT_PARM , unsigned int STAT_NAME
+#define STAT_ARG( name ) , name
+#define STAT_0_CNT( counter ) StatAdd( heapManager->stats.counters[counter].calls_0, 1 )
+#else
+#define STAT_NAME
+#define STAT_PARM
+#define STAT_ARG( name )
+#define STAT_0_CNT( counter )
+#endif // __STATISTICS__
 
 #define BOOT_HEAP_MANAGER() \
   	if ( UNLIKELY( heapManager == (Heap *)1 ) ) { /* new thread ? */ \
 		heapManagerCtor(); /* trigger for first heap, singleton */ \
 		assert( heapManager ); \
-	} /* if */
+	} /* if */ \
+	PERCPU_HEAP()
+
+#ifdef __PERCPU__
+#define PERCPU_HEAP() heapManager = cpuHeap(); /* heap of the current CPU */
+#else
+#define PERCPU_HEAP()
+#endif // __PERCPU__
 
 // NULL_0_ALLOC is disabled because many programs incorrectly check for out of memory by just checking for a NULL
 // return from malloc, rather than checking both NULL return and errno == ENOMEM.
@@ -1234,6 +3016,10 @@ static inline __attribute__((always_inline)) void * doMalloc( size_t size STAT_P
 
 	LLDEBUG( debugprt( "\tdoMalloc heap %p size %zd ", heap, size ) );
 
+	#ifdef __OWNERSHIP__
+	if ( UNLIKELY( heap->remoteBatched != 0 ) ) remoteFlushAll( heap ); // publish pending remote frees
+	#endif // __OWNERSHIP__
+
 	#ifdef __NULL_0_ALLOC__
 	if ( UNLIKELY( size == 0 ) ) { STAT_0_CNT( STAT_NAME ); return nullptr; }
 	#endif // __NULL_0_ALLOC__
@@ -1248,64 +3034,72 @@ static inline __attribute__((always_inline)) void * doMalloc( size_t size STAT_P
 
 	// The user request must include space for the header allocated along with the storage block and is a multiple of
 	// the alignment size.
-	size_t tsize = size + sizeof(Heap::Storage);		// total request space needed
+	size_t tsize = size + HeaderSize;					// total request space needed
 
 	#ifdef __STATISTICS__
 	if ( UNLIKELY( size == 0 ) ) {						// malloc( 0 ) ?
-		heap->stats.counters[STAT_NAME].calls_0 += 1;
+		StatAdd( heap->stats.counters[STAT_NAME].calls_0, 1 );
 	} else {
-		heap->stats.counters[STAT_NAME].calls += 1;
-		heap->stats.counters[STAT_NAME].request += size;
+		StatAdd( heap->stats.counters[STAT_NAME].calls, 1 );
+		StatAdd( heap->stats.counters[STAT_NAME].request, size );
 	} // if
+	assert( STAT_NAME < HeapStatistics::DELETE );		// allocation API ?
+	StatAdd( heap->stats.sizes[STAT_NAME][sizeBin( size )], 1 );
 	#endif // __STATISTICS__
 
 	#ifdef __DEBUG__
-	heap->allocUnfreed += size;
+	StatAdd( heap->allocUnfreed, size );
 	#endif // __DEBUG__
 
 	if ( LIKELY( size < heapMaster.mmapStart ) ) {		// small size => sbrk
-		Heap::FreeHeader * freeHead =
-			#ifdef __FASTLOOKUP__
-			LIKELY( tsize < LookupSizes ) ? &(heap->freeLists[lookup[tsize]]) :
-			#endif // __FASTLOOKUP__
-			&(heap->freeLists[Bsearchl( tsize, bucketSizes, heapMaster.maxBucketsUsed )]); // binary search
+		Heap::FreeHeader * freeHead = &(heap->freeLists[bucketIndex( tsize )]);
 
 		assert( freeHead <= &heap->freeLists[heapMaster.maxBucketsUsed] ); // subscripting error ?
 		assert( tsize <= freeHead->blockSize );			// search failure ?
 
 		#ifdef __STATISTICS__
-		heap->stats.counters[STAT_NAME].alloc += freeHead->blockSize; // total space needed for request
+		StatAdd( heap->stats.counters[STAT_NAME].alloc, freeHead->blockSize ); // total space needed for request
+		StatAdd( freeHead->request, size );
 		#endif // __STATISTICS__
 
 		// The checking order for freed storage versus bump storage has a performance difference, if there are lots of
 		// allocations before frees. The following checks for freed storage first in an attempt to reduce the storage
 		// footprint, i.e., starting using freed storage before using all the free block.
 
+		#ifdef __PERCPU__
+		block = freeListPop( heap, freeHead - heap->freeLists ); // remove node from stack
+		#else
 		block = freeHead->freeList;						// remove node from stack
+		#endif // __PERCPU__
 		// For reused memory, it is scrubbed in doFree for debug, so no scrubbing on allocation side.
 		if ( LIKELY( block != nullptr ) ) {				// free block ?
 			LLDEBUG( debugprt( "free list " ) );
+			#ifndef __PERCPU__
 			// Get storage from the corresponding free list.
 			freeHead->freeList = block->header.kind.real.next;
+			#endif // ! __PERCPU__
+			#ifdef __DEPOT__
+			freeHead->freeCount -= freeHead->freeCount != 0; // underestimate => may be zero
+			#endif // __DEPOT__
 
 			#ifdef __STATISTICS__
-			freeHead->reuses += 1;
+			StatAdd( freeHead->reuses, 1 );
 			#endif // __STATISTICS__
 		} else {
 			#ifdef __OWNERSHIP__
 			// Race with adding thread, get next time if lose race.
 			if ( UNLIKELY( freeHead->remoteList ) ) {	// returned space ?
 				LLDEBUG( debugprt( "returned " ) );
-				// Get storage by removing entire remote list, take first node, and chain remainder onto appropriate free list.
-				block = Fas( freeHead->remoteList, nullptr );
-				freeHead->freeList = block->header.kind.real.next; // remainder becomes free list
-
-				#ifdef __STATISTICS__
-				heap->stats.remote_pulls += 1;
-				#endif // __STATISTICS__
+				// Get storage by removing entire remote list, take first node, and remainder becomes the free list.
+				remotePull( heap, freeHead );
+				block = freeHead->freeList;
+				freeHead->freeList = block->header.kind.real.next;
 			} else {
 			#endif // __OWNERSHIP__
 				// Get storage from free block using bump allocation.
+				#ifdef __PERCPU__
+				pthread_mutex_lock( &heap->bufLock );	// threads running on the CPU share the buffer
+				#endif // __PERCPU__
 				tsize = freeHead->blockSize;			// optimization, bucket size for request
 				ptrdiff_t rem = heap->bufRemaining - tsize;
 				if ( LIKELY( rem >= 0 ) ) {				// bump storage ?
@@ -1316,18 +3110,45 @@ static inline __attribute__((always_inline)) void * doMalloc( size_t size STAT_P
 				} else {
 					LLDEBUG( debugprt( "get      " ) );
 					// Get storage from a *new* free block using bump alocation.
-					block = (Heap::Storage *)manager_extend( tsize ); // mutual exclusion on call
-					if ( UNLIKELY( block == nullptr ) ) { return nullptr; } // no memory ?
+					block = nullptr;
+					#ifdef __OWNERSHIP__
+					// Before extending, reclaim storage returned to other buckets, which may include this bucket after a race.
+					if ( heap->remotePending != 0 ) { block = remoteDrain( heap, freeHead ); heapDecay( heap ); }
+					#endif // __OWNERSHIP__
+					#ifndef __PERCPU__
+					// Then reuse storage donated by terminated threads (racy check). An explicit heap only uses its own
+					// extents, as heap_destroy releases them.
+					if ( block == nullptr && heapMaster.donated[freeHead - heap->freeLists] != nullptr && ! heap->explicitHeap ) block = donateGet( heap, freeHead );
+					#endif // ! __PERCPU__
+					#ifdef __DEPOT__
+					// Then refill from storage spilled by other heaps (racy check).
+					if ( block == nullptr && heapMaster.depot[freeHead - heap->freeLists].top != nullptr && ! heap->explicitHeap ) block = depotRefill( heap, freeHead );
+					#endif // __DEPOT__
+					if ( block == nullptr ) block = (Heap::Storage *)manager_extend( tsize ); // mutual exclusion on call
+					if ( UNLIKELY( block == nullptr ) ) { // no memory ?
+						#ifdef __PERCPU__
+						pthread_mutex_unlock( &heap->bufLock );
+						#endif // __PERCPU__
+						#ifdef __DEBUG__
+						StatAdd( heap->allocUnfreed, -size );		// failed allocation is not unfreed
+						#endif // __DEBUG__
+						return nullptr;
+					} // if
 
 					#ifdef __DEBUG__
 					// For new memory, scrub so subsequent uninitialized usages might fail. Only scrub the first scrub_size bytes.
 					memset( block->data, SCRUB, Min( scrub_size, tsize - sizeof(Heap::Storage) ) );
 					#endif // __DEBUG__
 				} // if
+				#ifdef __PERCPU__
+				pthread_mutex_unlock( &heap->bufLock );
+				#endif // __PERCPU__
+			#ifdef __OWNERSHIP__
 			} // if
+			#endif // __OWNERSHIP__
 
 			#ifdef __STATISTICS__
-			freeHead->allocations += 1;
+			StatAdd( freeHead->allocations, 1 );
 			#endif // __STATISTICS__
 		} // if
 
@@ -1340,24 +3161,56 @@ static inline __attribute__((always_inline)) void * doMalloc( size_t size STAT_P
 		if ( UNLIKELY( size > ULONG_MAX - heapMaster.pageSize ) ) { errno = ENOMEM; return nullptr; }
 		#endif // __DEBUG__
 
-		tsize = Ceiling( tsize, heapMaster.pageSize );	// must be multiple of page size
+		tsize = Ceiling( size + sizeof(Heap::Storage), heapMaster.pageSize ); // must be multiple of page size
 
-		#ifdef __STATISTICS__
-		heap->stats.counters[STAT_NAME].alloc += tsize;
-		heap->stats.mmap_calls += 1;
-		heap->stats.mmap_request += size;
-		heap->stats.mmap_alloc += tsize;
-		#endif // __STATISTICS__
+		block = heapMaster.mmapCacheCnt != 0 && ! heap->explicitHeap ? mmapCacheGet( tsize ) : nullptr; // racy check of cache
+		if ( block != nullptr ) {						// cached mapping ?
+			LLDEBUG( debugprt( "cached " ) );
+			block->header.kind.real.blockSize = MarkMmappedReusedBit( MarkMmappedBit( tsize ) ); // not zero filled
 
-		block = (Heap::Storage *)::mmap( 0, tsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
-		if ( UNLIKELY( block == MAP_FAILED ) ) {		// failed ?
-			// if ( errno == ENOMEM ) abort( NO_MEMORY_MSG, tsize ); // no memory
-			if ( errno == ENOMEM ) { return nullptr; }	// no memory
-			// Do not call strerror( errno ) as it may call malloc.
-			abort( "**** Error **** attempt to allocate large object (> %zu) of size %zu bytes and mmap failed with errno %d.",
-				   size, heapMaster.mmapStart, errno );
+			#ifdef __STATISTICS__
+			StatAdd( heap->stats.mmap_cache_hits, 1 );
+			StatAdd( heap->stats.mmap_cache_request, size );
+			StatAdd( heap->stats.mmap_cache_alloc, tsize );
+			#endif // __STATISTICS__
+		} else {
+			#ifdef __STATISTICS__
+			if ( heapMaster.mmapCacheMax != 0 ) StatAdd( heap->stats.mmap_cache_misses, 1 );
+			unsigned long long int faults = minorFaults(), start = cycleCount();
+			#endif // __STATISTICS__
+
+			if ( UNLIKELY( heap->explicitHeap ) ) {		// explicit heap ? => extent released by heap_destroy
+				tsize = Ceiling( tsize + sizeof(Heap::Extent), heapMaster.pageSize ) - sizeof(Heap::Extent);
+				block = (Heap::Storage *)extentMap( heap, tsize + sizeof(Heap::Extent) );
+				if ( UNLIKELY( block == nullptr ) ) block = (Heap::Storage *)MAP_FAILED; // errno == ENOMEM
+			} else {
+				block = (Heap::Storage *)::mmap( 0, tsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+			} // if
+			if ( UNLIKELY( block == MAP_FAILED ) ) {	// failed ?
+				// if ( errno == ENOMEM ) abort( NO_MEMORY_MSG, tsize ); // no memory
+				if ( errno == ENOMEM ) {				// no memory
+					#ifdef __DEBUG__
+					StatAdd( heap->allocUnfreed, -size );			// failed allocation is not unfreed
+					#endif // __DEBUG__
+					return nullptr;
+				} // if
+				// Do not call strerror( errno ) as it may call malloc.
+				abort( "**** Error **** attempt to allocate large object (> %zu) of size %zu bytes and mmap failed with errno %d.",
+					   size, heapMaster.mmapStart, errno );
+			} // if
+			block->header.kind.real.blockSize = MarkMmappedBit( tsize ); // storage size for munmap
+			LLPROBE( mmap, heap, size, tsize );
+			#ifdef __STATISTICS__
+			StatAdd( heap->stats.mmap_calls, 1 );				// cache hits are counted separately
+			StatAdd( heap->stats.mmap_request, size );
+			StatAdd( heap->stats.mmap_alloc, tsize );
+			slowPath( heap->stats, HeapStatistics::MMAP_CALL, start, faults ); // includes first-touch page fault
+			#endif // __STATISTICS__
 		} // if
-		block->header.kind.real.blockSize = MarkMmappedBit( tsize ); // storage size for munmap
+
+		#ifdef __STATISTICS__
+		StatAdd( heap->stats.counters[STAT_NAME].alloc, tsize );
+		#endif // __STATISTICS__
 
 		#ifdef __DEBUG__
 		// For new memory, scrub so subsequent uninitialized usages might fail. Only scrub the first scrub_size bytes.
@@ -1366,17 +3219,191 @@ static inline __attribute__((always_inline)) void * doMalloc( size_t size STAT_P
 		#endif // __DEBUG__
 	} // if
 
-	block->header.kind.real.size = size;				// store allocation size
 	void * addr = &(block->data);						// adjust off header to user bytes
+	setRequestSize( &block->header, addr, size );		// store allocation size
 	assert( ((uintptr_t)addr & (__ALIGN__ - 1)) == 0 ); // minimum alignment ?
 
+	// The countdown never expires without sampling, except to reread the sample rate.
+	#ifdef __PERCPU__
+	// The CPU heap is shared by the threads running on the CPU, so exactly one of them observes the countdown expiring.
+	ptrdiff_t countdown = Fai( heap->sampleCountdown, -(ptrdiff_t)size );
+	if ( UNLIKELY( countdown >= 0 && countdown < (ptrdiff_t)size ) ) sampleMalloc( heap, &block->header, size );
+	#else
+	if ( UNLIKELY( (heap->sampleCountdown -= size) < 0 ) ) sampleMalloc( heap, &block->header, size );
+	#endif // __PERCPU__
+
 	LLDEBUG( debugprt( "tsize %zd addr %p\n", tsize, addr ) );
 
 	return addr;
 } // doMalloc
 
 
-static inline __attribute__((always_inline)) void doFree( void * addr ) {
+#ifdef __SLAB__
+// Refill the allocating slab of class c with free blocks: first move the remote frees of the notified slabs onto their
+// free lists, then take the allocating slab if it received blocks, a partial slab, or a new slab carved from the slab
+// region. The old allocating slab is full and rejoins the partial list when the heap frees one of its blocks. Returns
+// a block, or nullptr if the slab region is exhausted.
+static __attribute__(( noinline )) Heap::Slab::Block * slabRefill( Heap * heap, size_t c ) {
+	for ( Heap::Slab * slab = Fas( heap->slabNotify[c], nullptr ), * next; slab != nullptr; slab = next ) {
+		next = slab->nextNotify;						// read before emptying the remote list, which allows a new notify
+		Heap::Slab::Block * remote = Fas( slab->remoteList, nullptr );
+		if ( slab->freeList == nullptr && slab != heap->slabs[c] ) { // not partial ?
+			slab->nextPartial = heap->slabPartial[c];
+			heap->slabPartial[c] = slab;
+		} // if
+		Heap::Slab::Block * last = remote;
+		while ( last->next != nullptr ) last = last->next;
+		last->next = slab->freeList;					// prepend remote frees
+		slab->freeList = remote;
+	} // for
+
+	Heap::Slab * slab = heap->slabs[c];
+	if ( slab == nullptr || slab->freeList == nullptr ) { // allocating slab still full ?
+		slab = heap->slabPartial[c];
+		if ( slab != nullptr ) {						// partial slab ?
+			heap->slabPartial[c] = slab->nextPartial;
+		} else {										// carve new slab
+			size_t offset = Fai( heapMaster.slabNext, (size_t)Heap::SlabSize );
+		  if ( UNLIKELY( offset >= heapMaster.slabExtent ) ) return nullptr; // slab region exhausted ?
+			slab = (Heap::Slab *)(heapMaster.slabStart + offset);
+			slab->owner = heap;
+			slab->blockSize = (c + 1) * 16;
+			slab->freeList = nullptr;
+			slab->bump = (char *)(slab + 1);
+			slab->remoteList = nullptr;
+			#ifdef __STATISTICS__
+			Fai( heapMaster.slabPages, 1 );
+			Fai( heapMaster.slabStorage, (size_t)Heap::SlabSize );
+			#endif // __STATISTICS__
+		} // if
+		heap->slabs[c] = slab;
+	} // if
+
+	Heap::Slab::Block * block = slab->freeList;
+	if ( block != nullptr ) {							// free block ?
+		slab->freeList = block->next;
+	} else {											// new slab => bump
+		block = (Heap::Slab::Block *)slab->bump;
+		slab->bump += slab->blockSize;
+	} // if
+	return block;
+} // slabRefill
+
+
+// Allocate a block of the slab class for size, which is at most SlabMax, or return nullptr if the slab region is
+// exhausted. The block has no header, so it has no sticky properties, and its request size is the block size.
+static inline __attribute__((always_inline)) void * slabMalloc( Heap * heap, size_t size STAT_PARM ) {
+	size_t c = size == 0 ? 0 : (size - 1) / 16;		// class
+	Heap::Slab * slab = heap->slabs[c];
+	Heap::Slab::Block * block;
+
+	if ( LIKELY( slab != nullptr && slab->freeList != nullptr ) ) { // free block ?
+		block = slab->freeList;
+		slab->freeList = block->next;
+	} else if ( LIKELY( slab != nullptr && slab->bump + slab->blockSize <= (char *)slab + Heap::SlabSize ) ) { // bump ?
+		block = (Heap::Slab::Block *)slab->bump;
+		slab->bump += slab->blockSize;
+	} else {
+		block = slabRefill( heap, c );
+	  if ( UNLIKELY( block == nullptr ) ) return nullptr;
+	} // if
+
+	#ifdef __STATISTICS__
+	if ( UNLIKELY( size == 0 ) ) {						// malloc( 0 ) ?
+		StatAdd( heap->stats.counters[STAT_NAME].calls_0, 1 );
+	} else {
+		StatAdd( heap->stats.counters[STAT_NAME].calls, 1 );
+		StatAdd( heap->stats.counters[STAT_NAME].request, size );
+	} // if
+	assert( STAT_NAME < HeapStatistics::DELETE );		// allocation API ?
+	StatAdd( heap->stats.sizes[STAT_NAME][sizeBin( size )], 1 );
+	StatAdd( heap->stats.counters[STAT_NAME].alloc, (c + 1) * 16 );
+	#endif // __STATISTICS__
+
+	#ifdef __DEBUG__
+	StatAdd( heap->allocUnfreed, (c + 1) * 16 );				// free only knows the block size
+	#endif // __DEBUG__
+
+	LLDEBUG( debugprt( "\tslabMalloc heap %p size %zd addr %p\n", heap, size, block ) );
+	return block;
+} // slabMalloc
+
+
+// Free a slab block: the owner pushes it on the slab's free list, and another thread pushes it on the slab's remote
+// list and, if the list was empty, notifies the owner.
+static inline __attribute__((always_inline)) void slabFree( Heap * heap, void * addr STAT_PARM ) {
+	Heap::Slab * slab = SlabOf( addr );
+	Heap::Slab::Block * block = (Heap::Slab::Block *)addr;
+	size_t c = slab->blockSize / 16 - 1;				// class
+
+	#ifdef __DEBUG__
+	if ( UNLIKELY( (char *)addr < (char *)(slab + 1) || ((char *)addr - (char *)(slab + 1)) % slab->blockSize != 0 ) ) {
+		abort( "**** Error **** attempt by thread %lx to free storage %p, which is not a block of slab %p.\n"
+			   "Possible cause is freeing an interior address of an allocation.",
+			   pthread_self(), addr, slab );
+	} // if
+	StatAdd( heap->allocUnfreed, -(slab->blockSize) );
+	if ( scrub_size != 0 ) memset( addr, SCRUB, Min( scrub_size, (size_t)slab->blockSize ) ); // scrub old memory
+	#endif // __DEBUG__
+
+	#ifdef __STATISTICS__
+	StatAdd( heap->stats.counters[STAT_NAME].calls, 1 );
+	StatAdd( heap->stats.counters[STAT_NAME].request, slab->blockSize ); // request size is unknown
+	StatAdd( heap->stats.counters[STAT_NAME].alloc, slab->blockSize );
+	#endif // __STATISTICS__
+
+	LLDEBUG( debugprt( "\tslabFree heap %p addr %p slab %p\n", heap, addr, slab ) );
+
+	if ( LIKELY( heap == slab->owner ) ) {				// belongs to this thread ?
+		if ( UNLIKELY( slab->freeList == nullptr ) && slab != heap->slabs[c] ) { // full slab => partial
+			slab->nextPartial = heap->slabPartial[c];
+			heap->slabPartial[c] = slab;
+		} // if
+		block->next = slab->freeList;					// push on stack
+		slab->freeList = block;
+	} else {											// return to owner
+		block->next = slab->remoteList;
+		// CAS resets block->next = slab->remoteList on failure
+		while ( ! Casv( slab->remoteList, block->next, block ) );
+		if ( block->next == nullptr ) {					// first remote free => notify owner
+			Heap * owner = slab->owner;
+			slab->nextNotify = owner->slabNotify[c];
+			while ( ! Casv( owner->slabNotify[c], slab->nextNotify, slab ) );
+		} // if
+		#ifdef __STATISTICS__
+		StatAdd( heap->stats.remote_pushes, 1 );
+		StatAdd( heap->stats.remote_request, slab->blockSize );
+		StatAdd( heap->stats.remote_alloc, slab->blockSize );
+		#endif // __STATISTICS__
+	} // if
+} // slabFree
+#endif // __SLAB__
+
+
+// Allocate small requests without sticky properties from slabs, when possible, and others from the buckets.
+static inline __attribute__((always_inline)) void * doSlabMalloc( size_t size STAT_PARM ) {
+	#ifdef __SLAB__
+	#ifdef __NULL_0_ALLOC__
+	if ( UNLIKELY( size == 0 ) ) return doMalloc( size STAT_ARG( STAT_NAME ) ); // => nullptr
+	#endif // __NULL_0_ALLOC__
+	if ( LIKELY( size <= Heap::SlabMax ) ) {
+		BOOT_HEAP_MANAGER();
+		Heap * heap = heapManager;						// optimization, as heapManager is thread_local
+		#ifdef __OWNERSHIP__
+		if ( UNLIKELY( heap->remoteBatched != 0 ) ) remoteFlushAll( heap ); // publish pending remote frees
+		#endif // __OWNERSHIP__
+		if ( void * addr = slabMalloc( heap, size STAT_ARG( STAT_NAME ) ); LIKELY( addr != nullptr ) ) return addr;
+	} // if
+	#endif // __SLAB__
+	return doMalloc( size STAT_ARG( STAT_NAME ) );
+} // doSlabMalloc
+
+
+static void freeSampled( Heap::Storage::Header * header, void * addr STAT_PARM, bool sized, bool fake, bool explicitHeap );
+
+// sized => fake is computed from the caller's alignment and size (sized deallocation), otherwise decoded from the header.
+// explicitHeap => heap_free of storage from the explicit heap installed in heapManager.
+static inline __attribute__((always_inline)) void doFree( void * addr STAT_PARM, bool sized = false, bool fake = false, bool explicitHeap = false ) {
 	#if defined( __STATISTICS__ ) || defined( __DEBUG__ ) || ! defined( __OWNERSHIP__ )
 	// A thread can run without a heap, and hence, have an uninitialized heapManager. For example, in the ownership
 	// program, the consumer thread does not allocate storage, it only frees storage back to the owning producer
@@ -1392,30 +3419,49 @@ static inline __attribute__((always_inline)) void doFree( void * addr ) {
 	assert( addr );										// addr == nullptr handled in free
 	Heap * heap = heapManager;							// optimization, as heapManager is thread_local
 
+	#ifdef __SLAB__
+	if ( SlabBlock( addr ) ) { slabFree( heap, addr STAT_ARG( STAT_NAME ) ); return; }
+	#endif // __SLAB__
+
 	Heap::Storage::Header * header;
 	Heap::FreeHeader * freeHead;
 	size_t tsize, alignment;
 
+	#ifdef __DEBUG__
+	// Always decode the header to check it; the caller's size and alignment are checked in checkSized.
+	(void)sized; (void)fake;
 	bool mapped = headers( "free", addr, header, freeHead, tsize, alignment );
+	if ( UNLIKELY( ! mapped && (explicitHeap || freeHead->homeManager->explicitHeap) && freeHead->homeManager != heap ) ) {
+		abort( "**** Error **** attempt by thread %lx to %s storage %p allocated from heap %p.\n"
+			   "Possible cause is storage of an explicit heap freed by free/realloc, or by heap_free with the wrong heap.",
+			   pthread_self(), explicitHeap ? "heap_free" : "free", addr, freeHead->homeManager );
+	} // if
+	#else
+	bool mapped = sized ? sizedHeaders( addr, fake, header, freeHead, tsize ) :
+		headers( "free", addr, header, freeHead, tsize, alignment );
+	#endif // __DEBUG__
 
 	LLDEBUG( debugprt( "\tdoFree heap %p addr %p tsize %zd ", heap, addr, tsize ) );
 
+	// A sampled block is freed out of line by a tail call, so the fast path saves no registers for the call.
+	if ( UNLIKELY( SampledBit( header ) ) ) { freeSampled( header, addr STAT_ARG( STAT_NAME ), sized, fake, explicitHeap ); return; }
+
 	#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
-	size_t size = header->kind.real.size;				// optimization
+	size_t size = requestSize( header, addr );			// optimization
 
 	#ifdef __DEBUG__
-	heap->allocUnfreed -= size;
+	StatAdd( heap->allocUnfreed, -size );
 	#endif // __DEBUG__
 
 	#ifdef __STATISTICS__
 	#ifndef __NULL_0_ALLOC__
 	if ( UNLIKELY( size == 0 ) )						// malloc( 0 ) ?
-		heap->stats.free_null_0_calls += 1;
+		StatAdd( heap->stats.counters[STAT_NAME].calls_0, 1 );
 	else
 	#endif // __NULL_0_ALLOC__
-		heap->stats.free_calls += 1;					// count free amd implicit frees from resize/realloc
-	heap->stats.free_request += size;
-	heap->stats.free_alloc += tsize;
+		StatAdd( heap->stats.counters[STAT_NAME].calls, 1 );		// count free amd implicit frees from resize/realloc
+	StatAdd( heap->stats.counters[STAT_NAME].request, size );
+	StatAdd( heap->stats.counters[STAT_NAME].alloc, tsize );
 	#endif // __STATISTICS__
 	#endif // __STATISTICS__ || __DEBUG__
 
@@ -1440,18 +3486,32 @@ static inline __attribute__((always_inline)) void doFree( void * addr ) {
 			LLDEBUG( debugprt( "free list\n " ) );
 			header->kind.real.next = freeHead->freeList; // push on stack
 			freeHead->freeList = (Heap::Storage *)header;
+			if ( UNLIKELY( --heap->purgeTick == 0 ) ) heapPurge( heap ); // amortized decay check
 		} else {										// return to thread owner
 			LLDEBUG( debugprt( "remote\n" ) );
-			header->kind.real.next = freeHead->remoteList; // link new node to top node
-			// CAS resets header->kind.real.next = freeHead->remoteList on failure
-			while ( ! Casv( freeHead->remoteList, header->kind.real.next, (Heap::Storage *)header ) );
+			if ( LIKELY( heap != (Heap *)1 && ! heapExited ) ) { // thread has a heap ? => batch
+				// Buckets are consecutive, so different buckets of a heap hash to different slots.
+				Heap::RemoteBatch & batch = heap->remoteBatches[(uintptr_t)freeHead / sizeof(Heap::FreeHeader) % Heap::RemoteSlots];
+				if ( UNLIKELY( batch.freeHead != freeHead ) ) { // slot empty or for another bucket ?
+					if ( batch.freeHead != nullptr ) remoteFlush( heap, batch );
+					batch.freeHead = freeHead;
+					batch.last = (Heap::Storage *)header;
+					heap->remoteBatched += 1;
+				} // if
+				header->kind.real.next = batch.first;	// push on chain
+				batch.first = (Heap::Storage *)header;
+				if ( UNLIKELY( ++batch.count == Heap::RemoteChain ) ) remoteFlush( heap, batch );
+				if ( UNLIKELY( --heap->purgeTick == 0 ) ) heapPurge( heap ); // amortized decay check of freeing heap
+			} else {
+				remotePush( freeHead, (Heap::Storage *)header, (Heap::Storage *)header );
+			} // if
 
 			assert( heap );
 
 			#ifdef __STATISTICS__
-			heap->stats.remote_pushes += 1;
-			heap->stats.remote_request += size;
-			heap->stats.remote_alloc += tsize;
+			StatAdd( heap->stats.remote_pushes, 1 );
+			StatAdd( heap->stats.remote_request, size );
+			StatAdd( heap->stats.remote_alloc, tsize );
 			#endif // __STATISTICS__
 		} // if
 
@@ -1460,27 +3520,46 @@ static inline __attribute__((always_inline)) void doFree( void * addr ) {
 		assert( heap );
 
 		// kind.real.home is address in owner thread's freeLists, so compute the equivalent position in this thread's freeList.
+		#ifdef __PERCPU__
+		freeListPush( heap, freeHead - &freeHead->homeManager->freeLists[0], (Heap::Storage *)header, (Heap::Storage *)header );
+		// The CPU heap is shared by the threads running on the CPU, so exactly one of them observes the tick expiring.
+		if ( UNLIKELY( Fai( heap->purgeTick, -1U ) == 1 ) ) heapPurge( heap ); // amortized decay check
+		#else
 		freeHead = &heap->freeLists[ClearStickyBits( header->kind.real.home ) - &freeHead->homeManager->freeLists[0]];
 		header->kind.real.next = freeHead->freeList;	// push on stack
 		freeHead->freeList = (Heap::Storage *)header;
+		#ifdef __DEPOT__
+		if ( UNLIKELY( ++freeHead->freeCount > freeHead->depotBatch * __DEPOT_HIGH_WATER__ ) && ! explicitHeap ) depotSpill( heap, freeHead );
+		#endif // __DEPOT__
+		if ( UNLIKELY( --heap->purgeTick == 0 ) ) heapPurge( heap ); // amortized decay check
+		#endif // __PERCPU__
 		#endif // __OWNERSHIP__
 	} else {											// mmapped
 		LLDEBUG( debugprt( "mmapped\n" ) );
-		#ifdef __STATISTICS__
-		heap->stats.munmap_calls += 1;
-		heap->stats.munmap_request += size;
-		heap->stats.munmap_alloc += tsize;
-		#endif // __STATISTICS__
-
-		if ( UNLIKELY( munmap( header, tsize ) == -1 ) ) {
-			// Do not call strerror( errno ) as it may call malloc.
-			abort( "**** Error **** attempt to deallocate large object %p and munmap failed with errno %d.\n"
-				   "Possible cause is invalid delete pointer: either not allocated or with corrupt header.",
-				   addr, errno );
+		if ( UNLIKELY( explicitHeap ) || ! mmapCachePut( (Heap::Storage *)header, tsize ) ) { // not cached => return to OS
+			#ifdef __STATISTICS__
+			StatAdd( heap->stats.munmap_calls, 1 );
+			StatAdd( heap->stats.munmap_request, size );
+			StatAdd( heap->stats.munmap_alloc, tsize );
+			unsigned long long int start = cycleCount();
+			#endif // __STATISTICS__
+			LLPROBE( munmap, heap, addr, tsize );
+			if ( UNLIKELY( explicitHeap ) ) extentUnmap( heap, (Heap::Extent *)header - 1 ); // extent of explicit heap
+			else unmap( header, tsize );
+			#ifdef __STATISTICS__
+			slowPath( heap->stats, HeapStatistics::MUNMAP_CALL, start );
+			#endif // __STATISTICS__
 		} // if
 	} // if
 } // doFree
 
+// Remove the sample of a block sampled by the heap profiler, and free the block.
+static __attribute__(( noinline )) void freeSampled( Heap::Storage::Header * header, void * addr STAT_PARM, bool sized, bool fake, bool explicitHeap ) {
+	sampleFree( header );
+	ClearSampledBit( header );
+	doFree( addr STAT_ARG( STAT_NAME ), sized, fake, explicitHeap );
+} // freeSampled
+
 
 static inline __attribute__((always_inline)) void * memalignNoStats( size_t alignment, size_t size STAT_PARM ) {
 	LLDEBUG( debugprt( "\tmemalignNoStats %zd %zd\n", alignment, size ) );
@@ -1510,9 +3589,9 @@ static inline __attribute__((always_inline)) void * memalignNoStats( size_t alig
 
 	// address of header from malloc
 	Heap::Storage::Header * realHeader = HeaderAddr( addr );
-	realHeader->kind.real.size = size;					// correct size to eliminate above alignment offset
+	setRequestSize( realHeader, user, size );			// correct size to eliminate above alignment offset
 	#ifdef __DEBUG__
-	heapManager->allocUnfreed -= offset;				// adjustment off the offset from call to doMalloc
+	StatAdd( heapManager->allocUnfreed, -offset );				// adjustment off the offset from call to doMalloc
 	#endif // __DEBUG__
 
 	// address of fake header *before* the alignment location
@@ -1526,7 +3605,22 @@ static inline __attribute__((always_inline)) void * memalignNoStats( size_t alig
 	return user;
 } // memalignNoStats
 
-// Operators new and new [] call malloc; delete calls free
+
+#ifdef __SLAB__
+// Resize or realloc a slab block, which has no sticky properties. The block is kept if the new size fits with at most
+// 50% wasted storage; otherwise, the contents are copied for realloc to storage with the new alignment. For resize,
+// the block is freed even if the new allocation fails.
+static void * slabRealloc( void * oaddr, size_t alignment, size_t size, bool copy STAT_PARM ) {
+	size_t bsize = SlabOf( oaddr )->blockSize;
+  if ( alignment <= __ALIGN__ && size <= bsize && bsize <= size * 2 ) return oaddr;
+	void * naddr = alignment <= __ALIGN__ ? doSlabMalloc( size STAT_ARG( STAT_NAME ) ) :
+		memalignNoStats( alignment, size STAT_ARG( STAT_NAME ) );
+  if ( UNLIKELY( naddr == nullptr ) && copy ) return nullptr; // stop further processing => oaddr not overwritten or freed
+	if ( copy ) memcpy( naddr, oaddr, Min( bsize, size ) );
+	doFree( oaddr STAT_ARG( HeapStatistics::FREE ) );
+	return naddr;
+} // slabRealloc
+#endif // __SLAB__
 
 
 //####################### Memory Allocation Routines ####################
@@ -1537,14 +3631,14 @@ extern "C" {
 	// then malloc() returns a unique pointer value that can later be successfully passed to free().
 	void * malloc( size_t size ) {
 		LLDEBUG( debugprt( "malloc %zd ", size ) );
-		return doMalloc( size STAT_ARG( HeapStatistics::MALLOC ) );
+		return doSlabMalloc( size STAT_ARG( HeapStatistics::MALLOC ) );
 	} // malloc
 
 
 	// Same as malloc() except size bytes is an array of dimension elements each of elemSize bytes.
 	void * aalloc( size_t dimension, size_t elemSize ) {
 		LLDEBUG( debugprt( "aalloc %zd %zd ", dimension, elemSize ) );
-		return doMalloc( dimension * elemSize STAT_ARG( HeapStatistics::AALLOC ) );
+		return doSlabMalloc( dimension * elemSize STAT_ARG( HeapStatistics::AALLOC ) );
 	} // aalloc
 
 
@@ -1561,7 +3655,8 @@ extern "C" {
 
 		#ifndef __DEBUG__
 		// Mapped storage is zero filled, but in debug mode mapped memory is scrubbed in doMalloc, so it has to be reset to zero.
-		if ( LIKELY( ! MmappedBit( header ) ) )
+		// Mapped storage reused from the mmap cache is not zero filled.
+		if ( LIKELY( ! MmappedBit( header ) || MmappedReusedBit( header ) ) )
 		#endif // __DEBUG__
 			// <-------0000000000000000000000000000UUUUUUUUUUUUUUUUUUUUUUUUU> bsize (bucket size) U => undefined
 			// `-header`-addr                      `-size
@@ -1586,10 +3681,14 @@ extern "C" {
 
 	  if ( UNLIKELY( size == 0 ) ) {
 			STAT_0_CNT( HeapStatistics::RESIZE );
-			doFree( oaddr );
+			doFree( oaddr STAT_ARG( HeapStatistics::FREE ) );
 			return nullptr;
 		} // if
 
+		#ifdef __SLAB__
+		if ( SlabBlock( oaddr ) ) return slabRealloc( oaddr, __ALIGN__, size, false STAT_ARG( HeapStatistics::RESIZE ) );
+		#endif // __SLAB__
+
 		Heap::Storage::Header * header;
 		Heap::FreeHeader * freeHead;
 		size_t bsize, oalignment;
@@ -1600,17 +3699,17 @@ extern "C" {
 		if ( oalignment == __ALIGN__ && size <= odsize && odsize <= size * 2 ) { // allow 50% wasted storage for smaller size
 			ClearZeroFillBit( header );					// no alignment and turn off 0 fill
 			#ifdef __DEBUG__
-			heapManager->allocUnfreed += size - header->kind.real.size; // adjustment off the size difference
+			StatAdd( heapManager->allocUnfreed, size - requestSize( header, oaddr ) ); // adjustment off the size difference
 			#endif // __DEBUG__
-			header->kind.real.size = size;				// reset allocation size
+			setRequestSize( header, oaddr, size );		// reset allocation size
 			#ifdef __STATISTICS__
-			heapManager->stats.resize_calls += 1;
+			StatAdd( heapManager->stats.resize_calls, 1 );
 			#endif // __STATISTICS__
 			return oaddr;
 		} // if
 
 		// change size, DO NOT PRESERVE STICKY PROPERTIES.
-		doFree( oaddr );								// always free original storage
+		doFree( oaddr STAT_ARG( HeapStatistics::FREE ) ); // always free original storage
 		return doMalloc( size STAT_ARG( HeapStatistics::RESIZE ) ); // create new area
 	} // resize
 
@@ -1633,25 +3732,29 @@ extern "C" {
 
 	  if ( UNLIKELY( nsize == 0 ) ) {
 			STAT_0_CNT( HeapStatistics::REALLOC );
-			doFree( oaddr );
+			doFree( oaddr STAT_ARG( HeapStatistics::FREE ) );
 			return nullptr;
 		} // if
 
+		#ifdef __SLAB__
+		if ( SlabBlock( oaddr ) ) return slabRealloc( oaddr, __ALIGN__, nsize, true STAT_ARG( HeapStatistics::REALLOC ) );
+		#endif // __SLAB__
+
 		Heap::Storage::Header * header;
 		Heap::FreeHeader * freeHead;
 		size_t bsize, oalignment;
 		headers( "realloc", oaddr, header, freeHead, bsize, oalignment );
 
 		size_t odsize = DataSize( bsize, oaddr, header ); // data storage available in bucket
-		size_t osize = header->kind.real.size;			// old allocation size
+		size_t osize = requestSize( header, oaddr );	// old allocation size
 		bool ozfill = ZeroFillBit( header );			// old allocation zero filled
 
 	  if ( UNLIKELY( nsize <= odsize ) && odsize <= nsize * 2 ) { // allow up to 50% wasted storage
 			LLDEBUG( debugprt( "reduce size " ) );
 			#ifdef __DEBUG__
-			heapManager->allocUnfreed += nsize - header->kind.real.size; // adjustment off the size difference
+			StatAdd( heapManager->allocUnfreed, nsize - osize );	// adjustment off the size difference
 			#endif // __DEBUG__
-			header->kind.real.size = nsize;				// reset allocation size
+			setRequestSize( header, oaddr, nsize );		// reset allocation size
 	  		if ( UNLIKELY( ozfill ) && nsize > osize ) { // previous request zero fill and larger ?
 				#ifdef __STATISTICS__
 				heapManager->stats.realloc_0_fill += 1;
@@ -1660,19 +3763,118 @@ extern "C" {
 	  			memset( (char *)oaddr + osize, '\0', nsize - osize ); // initialize added storage
 	  		} // if
 			#ifdef __STATISTICS__
-			heapManager->stats.realloc_calls += 1;
-			heapManager->stats.realloc_smaller += 1;
+			StatAdd( heapManager->stats.realloc_calls, 1 );
+			StatAdd( heapManager->stats.realloc_smaller, 1 );
 			#endif // __STATISTICS__
 			LLDEBUG( debugprt( "oaddr %p odsize %zd osize %zd nsize %zd bsize %zd\n", oaddr, odsize, osize, nsize, bsize ) );
 			return oaddr;
 		} // if
 
+		// Grow in place when the block is owned by this thread's heap and is the last block bump allocated from it, the
+		// bucket for the new size has no free storage, and the bump buffer absorbs the growth. The block is rebucketed to
+		// the bucket for the new size, as if allocated with that size. A CPU heap's buffer is shared, so per-CPU heaps do
+		// not grow in place.
+		#ifndef __PERCPU__
+		if ( LIKELY( ! MmappedBit( header ) ) && nsize > odsize && heapManager > (Heap *)1
+			 && freeHead->homeManager == heapManager && (char *)header + bsize == heapManager->bufStart ) {
+			size_t ntsize = nsize + ((char *)oaddr - (char *)header) - HeaderOverlap; // total request space needed
+			if ( ntsize < heapMaster.mmapStart ) {		// still bucket size ?
+				Heap::FreeHeader * nfreeHead = &(heapManager->freeLists[bucketIndex( ntsize )]);
+				size_t extra = nfreeHead->blockSize - bsize;
+				// Like doMalloc, prefer freed storage to bump storage, otherwise repeated growth consumes the buffer.
+				if ( nfreeHead->freeList == nullptr && extra <= heapManager->bufRemaining ) { // bump storage ?
+					LLDEBUG( debugprt( "grow in place from %zd to %zd\n", bsize, nfreeHead->blockSize ) );
+					heapManager->bufRemaining -= extra;
+					heapManager->bufStart = (char *)heapManager->bufStart + extra;
+					header->kind.real.home = (Heap::FreeHeader *)((uintptr_t)nfreeHead | StickyBits( header )); // retain sticky bits
+					setRequestSize( header, oaddr, nsize );
+
+					#ifdef __DEBUG__
+					StatAdd( heapManager->allocUnfreed, nsize - osize ); // adjustment off the size difference
+					#endif // __DEBUG__
+
+					#ifdef __STATISTICS__
+					// Account only the growth, so storage balances when the allocation is freed.
+					StatAdd( heapManager->stats.realloc_calls, 1 );
+					StatAdd( heapManager->stats.realloc_request, nsize - osize );
+					StatAdd( heapManager->stats.realloc_alloc, extra );
+					StatAdd( heapManager->stats.sizes[HeapStatistics::REALLOC][sizeBin( nsize )], 1 );
+					StatAdd( nfreeHead->allocations, 1 );
+					StatAdd( nfreeHead->request, nsize );
+					#endif // __STATISTICS__
+
+					if ( UNLIKELY( ozfill ) ) {			// previous request zero fill ?
+						#ifdef __STATISTICS__
+						heapManager->stats.realloc_0_fill += 1;
+						#endif // __STATISTICS__
+						memset( (char *)oaddr + osize, '\0', nsize - osize ); // initialize added storage
+					} // if
+					return oaddr;
+				} // if
+			} // if
+		} // if
+		#endif // ! __PERCPU__
+
+		// Remapping a mapped allocation moves its pages rather than copying its data. Offsets within pages are unchanged,
+		// so the data alignment is preserved up to the page size.
+		if ( UNLIKELY( MmappedBit( header ) ) && nsize >= heapMaster.mmapStart && oalignment <= heapMaster.pageSize ) {
+			size_t offset = (char *)oaddr - (char *)header; // data offset in mapping
+			size_t ntsize = Ceiling( offset + nsize, heapMaster.pageSize );
+			void * nblock = mremap( header, bsize, ntsize, MREMAP_MAYMOVE );
+			if ( LIKELY( nblock != MAP_FAILED ) ) {		// otherwise copy
+				LLDEBUG( debugprt( "mremap from %zd to %zd\n", bsize, ntsize ) );
+				if ( UNLIKELY( SampledBit( (Heap::Storage::Header *)nblock ) ) ) sampleMove( header, (Heap::Storage::Header *)nblock );
+				header = (Heap::Storage::Header *)nblock;
+				header->kind.real.blockSize += ntsize - bsize; // retain sticky bits
+				char * naddr = (char *)nblock + offset;
+				setRequestSize( header, naddr, nsize );
+
+				#if defined( __STATISTICS__ ) || defined( __DEBUG__ )
+				BOOT_HEAP_MANAGER();					// singlton
+				#endif // __STATISTICS__ || __DEBUG__
+
+				#ifdef __DEBUG__
+				StatAdd( heapManager->allocUnfreed, nsize - osize ); // adjustment off the size difference
+				#endif // __DEBUG__
+
+				#ifdef __STATISTICS__
+				// Account as a new mapping and an unmapping, so mapped storage balances when the allocation is freed.
+				HeapStatistics & stats = heapManager->stats;
+				StatAdd( stats.realloc_calls, 1 );
+				StatAdd( stats.realloc_request, nsize );
+				StatAdd( stats.realloc_alloc, ntsize );
+				StatAdd( stats.sizes[HeapStatistics::REALLOC][sizeBin( nsize )], 1 );
+				StatAdd( stats.free_calls, 1 );
+				StatAdd( stats.free_request, osize );
+				StatAdd( stats.free_alloc, bsize );
+				StatAdd( stats.mmap_calls, 1 );
+				StatAdd( stats.mmap_request, nsize );
+				StatAdd( stats.mmap_alloc, ntsize );
+				StatAdd( stats.munmap_calls, 1 );
+				StatAdd( stats.munmap_request, osize );
+				StatAdd( stats.munmap_alloc, bsize );
+				StatAdd( stats.realloc_mremap_calls, 1 );
+				StatAdd( stats.realloc_mremap_request, nsize );
+				StatAdd( stats.realloc_mremap_alloc, ntsize );
+				#endif // __STATISTICS__
+
+				if ( UNLIKELY( ozfill ) && nsize > osize ) { // previous request zero fill and larger ?
+					#ifdef __STATISTICS__
+					stats.realloc_0_fill += 1;
+					#endif // __STATISTICS__
+					// Pages added by mremap are zero filled, so only initialize the remainder of the old pages.
+					memset( naddr + osize, '\0', Min( nsize, bsize - offset ) - osize );
+				} // if
+				return naddr;
+			} // if
+		} // if
+
 		// change size and copy old content to new storage
 
 		LLDEBUG( debugprt( "increase size from %zd to %zd ", osize, nsize ) );
 
 		#ifdef __STATISTICS__
-		heapManager->stats.realloc_copy += 1;
+		StatAdd( heapManager->stats.realloc_copy, 1 );
 		#endif // __STATISTICS__
 
 		void * naddr;
@@ -1681,7 +3883,7 @@ extern "C" {
 		} else {
 			LLDEBUG( debugprt( "aligned " ) );
 			#ifdef __STATISTICS__
-			heapManager->stats.realloc_align += 1;
+			StatAdd( heapManager->stats.realloc_align, 1 );
 			#endif // __STATISTICS__
 			naddr = memalignNoStats( oalignment, nsize STAT_ARG( HeapStatistics::REALLOC ) ); // create new aligned area
 		} // if
@@ -1696,7 +3898,7 @@ extern "C" {
 		LLDEBUG( debugprt( "\tcopy / free oddr %p naddr %p osize %zd nsize %zd csize %zd odsize %zd",
 						   oaddr, naddr, osize, nsize, Min( osize, nsize ), odsize ) );
 		memcpy( naddr, oaddr, Min( osize, nsize ) );	// copy bytes
-		doFree( oaddr );								// free previous storage
+		doFree( oaddr STAT_ARG( HeapStatistics::FREE ) ); // free previous storage
 
 		if ( UNLIKELY( ozfill ) ) {						// previous request zero fill ?
 			MarkZeroFilledBit( header );				// mark new request as zero filled
@@ -1757,10 +3959,14 @@ extern "C" {
 
 	  if ( UNLIKELY( size == 0 ) ) {
 			STAT_0_CNT( HeapStatistics::ALIGNED_RESIZE );
-			doFree( oaddr );
+			doFree( oaddr STAT_ARG( HeapStatistics::FREE ) );
 			return nullptr;
 		} // if
 
+		#ifdef __SLAB__
+		if ( SlabBlock( oaddr ) ) return slabRealloc( oaddr, nalignment, size, false STAT_ARG( HeapStatistics::ALIGNED_RESIZE ) );
+		#endif // __SLAB__
+
 		nalignment = Max( nalignment, (size_t)__ALIGN__ ); // old programs use 8
 
 		// Attempt to reuse existing alignment.
@@ -1789,11 +3995,11 @@ extern "C" {
 
 					ClearZeroFillBit( header );			// turn off 0 fill
 					#ifdef __DEBUG__
-					heapManager->allocUnfreed += size - header->kind.real.size; // adjustment off the size difference
+					StatAdd( heapManager->allocUnfreed, size - requestSize( header, oaddr ) ); // adjustment off the size difference
 					#endif // __DEBUG__
-					header->kind.real.size = size;		// reset allocation size
+					setRequestSize( header, oaddr, size ); // reset allocation size
 					#ifdef __STATISTICS__
-					heapManager->stats.aligned_resize_calls += 1;
+					StatAdd( heapManager->stats.aligned_resize_calls, 1 );
 					#endif // __STATISTICS__
 					return oaddr;
 				} // if
@@ -1803,7 +4009,7 @@ extern "C" {
 		} // if
 
 		// change size, DO NOT PRESERVE STICKY PROPERTIES.
-		doFree( oaddr );								// always free original storage
+		doFree( oaddr STAT_ARG( HeapStatistics::FREE ) ); // always free original storage
 		return memalignNoStats( nalignment, size STAT_ARG( HeapStatistics::ALIGNED_RESIZE ) ); // create new aligned area
 	} // aligned_resize
 
@@ -1820,10 +4026,14 @@ extern "C" {
 
 	  if ( UNLIKELY( size == 0 ) ) {
 			STAT_0_CNT( HeapStatistics::ALIGNED_REALLOC );
-			doFree( oaddr );
+			doFree( oaddr STAT_ARG( HeapStatistics::FREE ) );
 			return nullptr;
 		} // if
 
+		#ifdef __SLAB__
+		if ( SlabBlock( oaddr ) ) return slabRealloc( oaddr, nalignment, size, true STAT_ARG( HeapStatistics::ALIGNED_REALLOC ) );
+		#endif // __SLAB__
+
 		// Attempt to reuse existing alignment.
 		Heap::Storage::Header * header = HeaderAddr( oaddr );
 		bool isFakeHeader = AlignmentBit( header );		// old fake header ?
@@ -1837,7 +4047,8 @@ extern "C" {
 			oalignment = ClearAlignmentBit( header );	// old alignment
 			if ( UNLIKELY( (uintptr_t)oaddr % nalignment == 0 // lucky match ?
 				 && ( oalignment <= nalignment			// going down
-					  || (oalignment >= nalignment && oalignment <= 256) ) // little alignment storage wasted ?
+					  || (oalignment >= nalignment && oalignment <= 256) // little alignment storage wasted ?
+					  || MmappedBit( RealHeader( header ) ) ) // mapped storage is remapped by realloc
 				) ) {
 				HeaderAddr( oaddr )->kind.fake.alignment = MarkAlignmentBit( nalignment ); // update alignment (could be the same)
 				return realloc( oaddr, size );			// duplicate special case checks
@@ -1852,7 +4063,7 @@ extern "C" {
 
 		// change size and copy old content to new storage
 
-		size_t osize = header->kind.real.size;			// old allocation size
+		size_t osize = requestSize( header, oaddr );	// old allocation size
 		bool ozfill = ZeroFillBit( header );			// old allocation zero filled
 
 		void * naddr = memalignNoStats( nalignment, size STAT_ARG( HeapStatistics::ALIGNED_REALLOC ) ); // create new aligned area
@@ -1864,7 +4075,7 @@ extern "C" {
 		fakeHeader( header, alignment );				// must have a fake header
 
 		memcpy( naddr, oaddr, Min( osize, size ) );		// copy bytes
-		doFree( oaddr );								// free previous storage
+		doFree( oaddr STAT_ARG( HeapStatistics::FREE ) ); // free previous storage
 
 		if ( UNLIKELY( ozfill ) ) {						// previous request zero fill ?
 			MarkZeroFilledBit( header );				// mark new request as zero filled
@@ -1926,7 +4137,8 @@ extern "C" {
 
 		#ifndef __DEBUG__
 		// Mapped storage is zero filled, but in debug mode mapped memory is scrubbed in doMalloc, so it has to be reset to zero.
-		if ( LIKELY( ! MmappedBit( header ) ) )
+		// Mapped storage reused from the mmap cache is not zero filled.
+		if ( LIKELY( ! MmappedBit( header ) || MmappedReusedBit( header ) ) )
 		#endif // __DEBUG__
 			// <-------0000000000000000000000000000UUUUUUUUUUUUUUUUUUUUUUUUU> bsize (bucket size) U => undefined
 			// `-header`-addr                      `-size
@@ -1989,10 +4201,155 @@ extern "C" {
 			return;
 		} // if
 
-		doFree( addr );									// handles heapManager == nullptr
+		doFree( addr STAT_ARG( HeapStatistics::FREE ) );	// handles heapManager == nullptr
 	} // free
 
 
+	// Same as free, but the caller supplies the allocation size (C23). Passing the wrong size is undefined.
+	void free_sized( void * addr, size_t size __attribute__(( unused )) ) {
+		LLDEBUG( debugprt( "free_sized %p %zd ", addr, size ) );
+
+	  if ( UNLIKELY( addr == nullptr ) ) {				// special case
+			LLDEBUG( debugprt( "\n" ) );
+			#ifdef __STATISTICS__
+			if ( LIKELY( heapManager > (Heap *)1 ) ) { heapManager->stats.free_null_0_calls += 1; }
+			else { Fai( heapMaster.stats.free_null_0_calls, 1 ); }
+			#endif // __STATISTICS__
+			return;
+		} // if
+
+		#ifdef __DEBUG__
+		checkSized( "free_sized", addr, size, __ALIGN__, true );
+		#endif // __DEBUG__
+		doFree( addr STAT_ARG( HeapStatistics::FREE ), true, false ); // malloc/calloc/realloc => no fake header
+	} // free_sized
+
+
+	// Same as free, but the caller supplies the allocation alignment and size (C23). Passing the wrong alignment or
+	// size is undefined.
+	void free_aligned_sized( void * addr, size_t alignment, size_t size ) {
+		LLDEBUG( debugprt( "free_aligned_sized %p %zd %zd ", addr, alignment, size ) );
+
+	  if ( UNLIKELY( addr == nullptr ) ) {				// special case
+			LLDEBUG( debugprt( "\n" ) );
+			#ifdef __STATISTICS__
+			if ( LIKELY( heapManager > (Heap *)1 ) ) { heapManager->stats.free_null_0_calls += 1; }
+			else { Fai( heapMaster.stats.free_null_0_calls, 1 ); }
+			#endif // __STATISTICS__
+			return;
+		} // if
+
+		bool fake = alignment > __ALIGN__ && size != 0;	// memalign only creates a fake header for these cases
+		#ifdef __DEBUG__
+		checkSized( "free_aligned_sized", addr, size, fake ? alignment : (size_t)__ALIGN__, true );
+		#endif // __DEBUG__
+		doFree( addr STAT_ARG( HeapStatistics::FREE ), true, fake );
+	} // free_aligned_sized
+
+
+	// Allocates n blocks of size bytes into out, the same as n calls to malloc( size ). The bucket is resolved once and
+	// the blocks are removed from its free list, remote list and buffer in one pass; an empty bucket falls back to
+	// malloc for each remaining block. Returns the number of blocks allocated, which is less than n only if there is
+	// insufficient memory (errno ENOMEM).
+	size_t malloc_batch( size_t size, size_t n, void ** out ) {
+		LLDEBUG( debugprt( "malloc_batch %zd %zd ", size, n ) );
+		size_t i = 0;
+
+		#ifndef __PERCPU__								// CPU heap can change on each allocation
+		BOOT_HEAP_MANAGER();
+		Heap * heap = heapManager;						// optimization, as heapManager is thread_local
+
+		if ( LIKELY( size < heapMaster.mmapStart
+					 #ifdef __NULL_0_ALLOC__
+					 && size != 0
+					 #endif // __NULL_0_ALLOC__
+				) ) {
+			#ifdef __OWNERSHIP__
+			if ( UNLIKELY( heap->remoteBatched != 0 ) ) remoteFlushAll( heap ); // publish pending remote frees
+			#endif // __OWNERSHIP__
+
+			size_t tsize = size + HeaderSize;			// total request space needed
+			Heap::FreeHeader * freeHead = &(heap->freeLists[bucketIndex( tsize )]);
+			size_t bumps __attribute__(( unused )) = 0;
+
+			while ( i < n ) {
+				Heap::Storage * block = freeHead->freeList;
+				if ( LIKELY( block != nullptr ) ) {		// free block ?
+					freeHead->freeList = block->header.kind.real.next;
+					#ifdef __DEPOT__
+					freeHead->freeCount -= freeHead->freeCount != 0; // underestimate => may be zero
+					#endif // __DEPOT__
+				#ifdef __OWNERSHIP__
+				} else if ( UNLIKELY( freeHead->remoteList ) ) { // returned space ?
+					remotePull( heap, freeHead );		// remote list becomes the free list
+					continue;
+				#endif // __OWNERSHIP__
+				} else if ( heap->bufRemaining >= freeHead->blockSize ) { // bump storage ?
+					block = (Heap::Storage *)heap->bufStart;
+					heap->bufStart = (char *)heap->bufStart + freeHead->blockSize;
+					heap->bufRemaining -= freeHead->blockSize;
+					bumps += 1;
+				} else {								// extend heap
+					break;
+				} // if
+				block->header.kind.real.home = freeHead; // pointer back to free list of apropriate size
+				out[i] = &(block->data);				// adjust off header to user bytes
+				setRequestSize( &block->header, out[i], size ); // store allocation size
+				i += 1;
+			} // while
+
+			#ifdef __STATISTICS__
+			if ( UNLIKELY( size == 0 ) ) {				// malloc( 0 ) ?
+				StatAdd( heap->stats.counters[HeapStatistics::MALLOC].calls_0, i );
+			} else {
+				StatAdd( heap->stats.counters[HeapStatistics::MALLOC].calls, i );
+				StatAdd( heap->stats.counters[HeapStatistics::MALLOC].request, i * size );
+			} // if
+			StatAdd( heap->stats.sizes[HeapStatistics::MALLOC][sizeBin( size )], i );
+			StatAdd( heap->stats.counters[HeapStatistics::MALLOC].alloc, i * freeHead->blockSize );
+			StatAdd( freeHead->reuses, i - bumps );
+			StatAdd( freeHead->allocations, bumps );
+			StatAdd( freeHead->request, i * size );
+			#endif // __STATISTICS__
+
+			#ifdef __DEBUG__
+			StatAdd( heap->allocUnfreed, i * size );
+			#endif // __DEBUG__
+		} // if
+		#endif // ! __PERCPU__
+
+		for ( ; i < n; i += 1 ) {						// remaining blocks
+			out[i] = doMalloc( size STAT_ARG( HeapStatistics::MALLOC ) );
+		  if ( UNLIKELY( out[i] == nullptr && size != 0 ) ) break; // no memory ?
+		} // for
+		return i;
+	} // malloc_batch
+
+
+	// Frees the n addresses in ptrs, the same as n calls to free. The next block's header is prefetched while a block is
+	// freed. Remote frees are chained per owner bucket, and the chains are pushed onto their owner's remote lists at the
+	// end, each with one CAS.
+	void free_batch( void ** ptrs, size_t n ) {
+		LLDEBUG( debugprt( "free_batch %p %zd\n", ptrs, n ) );
+		for ( size_t i = 0; i < n; i += 1 ) {
+			if ( i + 1 < n && ptrs[i + 1] != nullptr ) __builtin_prefetch( HeaderAddr( ptrs[i + 1] ) );
+			void * addr = ptrs[i];
+		  if ( UNLIKELY( addr == nullptr ) ) {			// special case
+				#ifdef __STATISTICS__
+				if ( LIKELY( heapManager > (Heap *)1 ) ) { heapManager->stats.free_null_0_calls += 1; }
+				else { Fai( heapMaster.stats.free_null_0_calls, 1 ); }
+				#endif // __STATISTICS__
+				continue;
+			} // if
+			doFree( addr STAT_ARG( HeapStatistics::FREE ) );
+		} // for
+
+		#ifdef __OWNERSHIP__
+		if ( heapManager > (Heap *)1 && heapManager->remoteBatched != 0 ) remoteFlushAll( heapManager ); // publish remote frees
+		#endif // __OWNERSHIP__
+	} // free_batch
+
+
 	// Sets the array size for extending the global heap array to accommodate thread creation.
 	__attribute__((weak)) size_t malloc_thread_extend( void ) { return __DEFAULT_THREAD_EXTEND__; }
 
@@ -2005,6 +4362,27 @@ extern "C" {
 	// Sets the crossover point between allocations occuring in the sbrk area or separately mmapped.
 	__attribute__((weak)) size_t malloc_mmap_start( void ) { return __DEFAULT_MMAP_START__; }
 
+	// Sets the time (milliseconds) free storage is idle before it is returned to the OS (0 => never).
+	__attribute__((weak)) size_t malloc_purge_decay( void ) { return __DEFAULT_PURGE_DECAY__; }
+
+	// Sets the huge-page mode for heap storage (0 => base pages, 1 => transparent huge pages, 2 => hugetlb pages).
+	__attribute__((weak)) size_t malloc_huge_pages( void ) { return __DEFAULT_HUGE_PAGES__; }
+
+	// Sets the maximum storage (bytes) of freed mapped allocations cached for reuse (0 => no cache).
+	__attribute__((weak)) size_t malloc_mmap_cache( void ) { return __DEFAULT_MMAP_CACHE__; }
+
+	// Sets the NUMA mode (0 => NUMA unaware, 1 => reservation pool per node, N > 1 => emulate N nodes).
+	__attribute__((weak)) size_t malloc_numa( void ) { return __DEFAULT_NUMA__; }
+
+	// Sets the storage policy for the heap of a terminating thread (see ExitPolicy).
+	__attribute__((weak)) size_t malloc_exit_policy( void ) { return __DEFAULT_EXIT_POLICY__; }
+
+	// Sets the average number of bytes allocated between heap-profile samples (0 => no sampling).
+	__attribute__((weak)) size_t malloc_sample_rate( void ) { return __DEFAULT_SAMPLE_RATE__; }
+
+	// Sets the size classes (Heap::NoBucketSizes increasing multiples of 16), nullptr => compiled table.
+	__attribute__((weak)) const unsigned int * malloc_size_classes( void ) { return nullptr; }
+
 	// Amount subtracted to adjust for unfreed program storage (debug only).
 	__attribute__((weak)) size_t malloc_unfreed( void ) { return __DEFAULT_HEAP_UNFREED__; }
 
@@ -2012,17 +4390,23 @@ extern "C" {
 	// Returns original total allocation size (not bucket size) => array size is dimension * sizeof(T).
 	size_t malloc_request_size( void * addr ) {
 	  if ( UNLIKELY( addr == nullptr ) ) return 0;		// null allocation has zero size
+		#ifdef __SLAB__
+	  if ( SlabBlock( addr ) ) return SlabOf( addr )->blockSize; // no header => block size
+		#endif // __SLAB__
 		Heap::Storage::Header * header = HeaderAddr( addr );
 		if ( UNLIKELY( AlignmentBit( header ) ) ) {		// fake header ?
 			header = RealHeader( header );				// backup from fake to real header
 		} // if
-		return header->kind.real.size;
+		return requestSize( header, addr );
 	} // malloc_request_size
 
 
 	// Returns the alignment of an allocation.
 	size_t malloc_alignment( void * addr ) {
 	  if ( UNLIKELY( addr == nullptr ) ) return __ALIGN__; // minimum alignment
+		#ifdef __SLAB__
+	  if ( SlabBlock( addr ) ) return __ALIGN__;		// minimum alignment
+		#endif // __SLAB__
 		Heap::Storage::Header * header = HeaderAddr( addr );
 		if ( UNLIKELY( AlignmentBit( header ) ) ) {		// fake header ?
 			return ClearAlignmentBit( header );			// clear flag from value
@@ -2035,6 +4419,9 @@ extern "C" {
 	// Returns true if the allocation is zero filled, e.g., allocated by calloc().
 	bool malloc_zero_fill( void * addr ) {
 	  if ( UNLIKELY( addr == nullptr ) ) return false;	// null allocation is not zero fill
+		#ifdef __SLAB__
+	  if ( SlabBlock( addr ) ) return false;			// calloc does not use slabs
+		#endif // __SLAB__
 		Heap::Storage::Header * header = HeaderAddr( addr );
 		if ( UNLIKELY( AlignmentBit( header ) ) ) {		// fake header ?
 			header = RealHeader( header );				// backup from fake to real header
@@ -2045,6 +4432,9 @@ extern "C" {
 
 	bool malloc_remote( void * addr ) {
 	  if ( UNLIKELY( addr == nullptr ) ) return false;	// null allocation is not zero fill
+		#ifdef __SLAB__
+	  if ( SlabBlock( addr ) ) return heapManager == SlabOf( addr )->owner;
+		#endif // __SLAB__
 		Heap::Storage::Header * header = HeaderAddr( addr );
 		if ( UNLIKELY( AlignmentBit( header ) ) ) {		// fake header ?
 			header = RealHeader( header );				// backup from fake to real header
@@ -2057,6 +4447,9 @@ extern "C" {
 	// malloc or a related function. Returned size is >= allocation size (bucket size).
 	size_t malloc_usable_size( void * addr ) {
 	  if ( UNLIKELY( addr == nullptr ) ) return 0;		// null allocation has zero size
+		#ifdef __SLAB__
+	  if ( SlabBlock( addr ) ) return SlabOf( addr )->blockSize; // no header => block size
+		#endif // __SLAB__
 		Heap::Storage::Header * header;
 		Heap::FreeHeader * freeHead;
 		size_t bsize, alignment;
@@ -2069,8 +4462,8 @@ extern "C" {
 		// means subsequently undefined usage, so the allocated storage is reset to the usable storage. Hence,
 		// downstream calls to realloc on this storage copy the usable rather than allocated storage. Putting the trick
 		// here means realloc only copies the smaller allocated storage when a program does not use malloc_usable_size.
-		header->kind.real.size = dsize;
-		LLDEBUG( debugprt( "malloc_usable_size addr %p bucket %zd allocated %zd dsize %zd\n", addr, bsize, header->kind.real.size, dsize ) );
+		setRequestSize( header, addr, dsize );
+		LLDEBUG( debugprt( "malloc_usable_size addr %p bucket %zd allocated %zd dsize %zd\n", addr, bsize, requestSize( header, addr ), dsize ) );
 		return dsize;
 	} // malloc_usable_size
 
@@ -2143,6 +4536,43 @@ extern "C" {
 	} // malloc_info
 
 
+	// Writes the heap profile of the sampled live allocations on file descriptor fd in the legacy pprof heap format
+	// (heap_v2), followed by the memory map of the process for symbolization, e.g., "pprof -top program profile".
+	// Returns the number of bytes written.
+	int malloc_sample_dump( int fd ) {
+		char helpText[BufSize];							// space for a sample and its call stack
+		int tlen = 0, len;
+
+		pthread_mutex_lock( &heapMaster.sampleLock );	// protect sample table
+		HeapMaster::Sample * samples = heapMaster.samples;
+		unsigned long long int storage = 0;				// live sampled storage
+		for ( size_t i = 0; samples != nullptr && i < __SAMPLE_SLOTS__; i += 1 ) {
+			if ( samples[i].header != nullptr ) storage += samples[i].size;
+		} // for
+		len = snprintf( helpText, sizeof(helpText), "heap profile: %zu: %llu [%llu: %llu] @ heap_v2/%zu\n",
+						heapMaster.sampleLive, storage, heapMaster.sampleCnt, heapMaster.sampleStorage, heapMaster.sampleRate );
+		tlen += write( fd, helpText, len );
+		for ( size_t i = 0; samples != nullptr && i < __SAMPLE_SLOTS__; i += 1 ) {
+		  if ( samples[i].header == nullptr ) continue;
+			len = snprintf( helpText, sizeof(helpText), "1: %zu [1: %zu] @", samples[i].size, samples[i].size );
+			for ( size_t d = 0; d < samples[i].depth; d += 1 ) {
+				len += snprintf( helpText + len, sizeof(helpText) - len, " %p", samples[i].pcs[d] );
+			} // for
+			helpText[len++] = '\n';
+			tlen += write( fd, helpText, len );
+		} // for
+		pthread_mutex_unlock( &heapMaster.sampleLock );
+
+		#define MAPPED_LIBRARIES_MSG "\nMAPPED_LIBRARIES:\n"
+		tlen += write( fd, MAPPED_LIBRARIES_MSG, sizeof( MAPPED_LIBRARIES_MSG ) - 1 /* size includes '\0' */ );
+		if ( int maps = open( "/proc/self/maps", O_RDONLY ); maps != -1 ) {
+			for ( ssize_t cnt; (cnt = read( maps, helpText, sizeof(helpText) )) > 0; ) tlen += write( fd, helpText, cnt );
+			close( maps );
+		} // if
+		return tlen;
+	} // malloc_sample_dump
+
+
 	// Adjusts parameters that control the behaviour of the memory-allocation functions (see malloc). The param argument
 	// specifies the parameter to be modified, and value specifies the new value for that parameter.
 	int mallopt( int option, int value ) {
@@ -2155,17 +4585,179 @@ extern "C" {
 		  case M_MMAP_THRESHOLD:
 			if ( setMmapStart( value ) ) return 1;
 			break;
+		  case M_PURGE_DECAY:
+			heapMaster.purgeDecay = value * 1'000'000ULL;	// milliseconds to nanoseconds
+			return 1;
+		  case M_HUGE_PAGES:
+			if ( value > HugetlbPages ) break;
+			heapMaster.hugePages = value;					// affects subsequent thread blocks
+			return 1;
+		  case M_MMAP_CACHE:
+			heapMaster.mmapCacheMax = value;				// cache shrinks as mappings are freed
+			if ( value == 0 ) mmapCacheRelease( ULLONG_MAX ); // no cache => release cached mappings
+			return 1;
+		  case M_NUMA:
+			setNuma( value );							// affects subsequent thread blocks
+			return 1;
+		  case M_EXIT_POLICY:
+			if ( value > ExitAll ) break;
+			heapMaster.exitPolicy = value;				// affects subsequent thread terminations
+			return 1;
+		  case M_SAMPLE_RATE:
+			if ( value != 0 ) { void * pc; backtrace( &pc, 1 ); } // load the unwinder before sampling
+			heapMaster.sampleRate = value;				// affects each heap's next sample interval
+			return 1;
 		} // switch
 		return 0;										// error, unsupported
 	} // mallopt
 
 
-	// Attempt to release free memory at the top of the heap (by calling sbrk with a suitable argument).
-	int malloc_trim( size_t ) {
-		return 0;										// => impossible to release memory
+	// Release the pages of free storage in the calling thread's heap and in the heaps of terminated threads to the
+	// OS, retaining pad bytes of free storage. Returns the number of bytes released. Heaps of running threads are not
+	// touched because only the owner thread can safely traverse its free lists. CPU heaps are trimmed by cpuHeapsTrim.
+	// Without ownership, the batches in the global depot are also trimmed.
+	size_t malloc_trim_bytes( size_t pad ) {
+	  if ( UNLIKELY( heapMasterBootFlag == 0 ) ) return 0; // no storage allocated ?
+		size_t released = mmapCacheRelease( ULLONG_MAX );	// all cached mappings
+
+		#ifdef __PERCPU__
+		released += cpuHeapsTrim( pad );				// CPU heaps are not on the free-heap stack => no mgrLock
+		pthread_mutex_lock( &heapMaster.mgrLock );		// protect heapMaster counters
+		#else
+		pthread_mutex_lock( &heapMaster.mgrLock );		// protect freeHeapManagersList and heapMaster counters
+		if ( heapManager > (Heap *)1 ) {				// thread has a heap ?
+			released += heapTrim( heapManager, pad );
+		} // if
+		for ( Heap * heap = heapMaster.freeHeapManagersList; heap; heap = heap->nextFreeHeapManager ) {
+			released += heapTrim( heap, pad );
+		} // for
+		#ifdef __DEPOT__
+		released += depotTrim( pad );
+		#endif // __DEPOT__
+		#endif // __PERCPU__
+
+		#ifdef __STATISTICS__
+		heapMaster.trimCalls += 1;
+		heapMaster.trimStorage += released;
+		#endif // __STATISTICS__
+		pthread_mutex_unlock( &heapMaster.mgrLock );
+		return released;
+	} // malloc_trim_bytes
+
+
+	// Release free memory to the OS, retaining pad bytes of free storage. Returns 1 if memory was released, 0 otherwise.
+	int malloc_trim( size_t pad ) {
+		return malloc_trim_bytes( pad ) != 0;
 	} // malloc_trim
 
 
+	// An explicit heap is an independent heap, whose storage is allocated by heap_malloc and freed by heap_free, or
+	// released all at once by heap_destroy. Its storage is mapped in extents, so heap_destroy costs one munmap per
+	// thread block and unfreed large allocation, rather than a free per allocation. Any thread can use an explicit heap,
+	// but not concurrently, as heap_malloc/heap_free temporarily install it as the calling thread's heap. CPU heaps are
+	// selected by the running CPU, so explicit heaps are unsupported with __PERCPU__.
+
+	// Create an explicit heap. Returns nullptr with errno set if unsupported.
+	heap_t * heap_create( void ) {
+		#ifdef __PERCPU__
+		errno = ENOTSUP;
+		return nullptr;
+		#else
+		BOOT_HEAP_MANAGER();							// boot llheap
+
+		pthread_mutex_lock( &heapMaster.mgrLock );		// protect freeExplicitHeapsList and heapMaster counters
+		Heap * heap = heapMaster.freeExplicitHeapsList;
+		if ( heap != nullptr ) {						// destroyed explicit heap for reuse ?
+			heapMaster.freeExplicitHeapsList = heap->nextFreeHeapManager;
+			heap->nextFreeHeapManager = nullptr;
+			#ifdef __STATISTICS__
+			heapMaster.heapReused += 1;
+			#endif // __STATISTICS__
+		} else {										// a thread heap has storage, so create new
+			heap = newHeap();
+		} // if
+
+		#ifdef __STATISTICS__
+		HeapStatisticsCtor( heap->stats );
+		heapMaster.explicitCreated += 1;
+		#endif // __STATISTICS__
+		pthread_mutex_unlock( &heapMaster.mgrLock );
+
+		heap->explicitHeap = true;
+		heap->sampleCountdown = PTRDIFF_MAX;			// no samples, as heap_destroy releases unfreed storage
+		return (heap_t *)heap;
+		#endif // __PERCPU__
+	} // heap_create
+
+
+	// Same as malloc, but allocates from the explicit heap.
+	void * heap_malloc( heap_t * heap, size_t size ) {
+		LLDEBUG( debugprt( "heap_malloc %p %zd ", heap, size ) );
+		Heap * save = heapManager;						// install explicit heap
+		heapManager = (Heap *)heap;
+		void * addr = doMalloc( size STAT_ARG( HeapStatistics::MALLOC ) );
+		heapManager = save;
+		return addr;
+	} // heap_malloc
+
+
+	// Same as free, but the storage must be from heap_malloc of the explicit heap.
+	void heap_free( heap_t * heap, void * addr ) {
+		LLDEBUG( debugprt( "heap_free %p %p ", heap, addr ) );
+
+	  if ( UNLIKELY( addr == nullptr ) ) {				// special case
+			LLDEBUG( debugprt( "\n" ) );
+			#ifdef __STATISTICS__
+			((Heap *)heap)->stats.free_null_0_calls += 1;
+			#endif // __STATISTICS__
+			return;
+		} // if
+
+		Heap * save = heapManager;						// install explicit heap
+		heapManager = (Heap *)heap;
+		doFree( addr STAT_ARG( HeapStatistics::FREE ), false, false, true );
+		heapManager = save;
+	} // heap_free
+
+
+	// Release all storage of the explicit heap, freed or not, and the heap itself.
+	void heap_destroy( heap_t * heap ) {
+	  if ( UNLIKELY( heap == nullptr ) ) return;
+		Heap * eheap = (Heap *)heap;
+		#ifdef __DEBUG__
+		if ( UNLIKELY( ! eheap->explicitHeap ) ) {
+			abort( "**** Error **** attempt by thread %lx to destroy heap %p, which is not an explicit heap.\n"
+				   "Possible cause is duplicate heap_destroy on same heap.",
+				   pthread_self(), heap );
+		} // if
+		#endif // __DEBUG__
+
+		#ifdef __OWNERSHIP__
+		if ( eheap->remoteBatched != 0 ) remoteFlushAll( eheap ); // pending frees belong to other heaps
+		#endif // __OWNERSHIP__
+
+		size_t released = 0;
+		for ( Heap::Extent * extent = eheap->extents, * next; extent != nullptr; extent = next ) {
+			next = extent->next;
+			released += extent->size;
+			unmap( extent, extent->size );
+		} // for
+
+		pthread_mutex_lock( &heapMaster.mgrLock );		// protect freeExplicitHeapsList and heapMaster counters
+		#ifdef __STATISTICS__
+		heapMaster.stats += eheap->stats;				// retain this heap's statistics
+		HeapStatisticsCtor( eheap->stats );
+		heapMaster.explicitDestroyed += 1;
+		heapMaster.explicitReleased += released;
+		#endif // __STATISTICS__
+
+		heapCtor( eheap );								// empty free lists, and unfreed storage is released
+		eheap->nextFreeHeapManager = heapMaster.freeExplicitHeapsList;
+		heapMaster.freeExplicitHeapsList = eheap;
+		pthread_mutex_unlock( &heapMaster.mgrLock );
+	} // heap_destroy
+
+
 	// Records the current state of all malloc internal bookkeeping variables (but not the actual contents of the heap
 	// or the state of malloc_hook functions pointers).  The state is recorded in a system-dependent opaque data
 	// structure dynamically allocated via malloc, and a pointer to that data structure is returned as the function
@@ -2183,6 +4775,167 @@ extern "C" {
 } // extern "C"
 
 
+//####################### C++ Memory Allocation Operators ####################
+
+
+// The replaceable operators new/delete call doMalloc/memalignNoStats/doFree directly, rather than through the
+// libstdc++ versions calling malloc/aligned_alloc/free, and have their own statistics counters to separate C++ from C
+// allocations.
+
+// As llheap is compiled without exceptions, std::bad_alloc is thrown from a routine compiled with exceptions, rather
+// than from a standard-library internal, so any C++ runtime can catch it.
+static __attribute__(( noinline, noreturn, cold, optimize( "exceptions" ) )) void throwBadAlloc() {
+	throw std::bad_alloc();
+} // throwBadAlloc
+
+// Allocation failed (or zero request with __NULL_0_ALLOC__): call the new handler and retry until there is storage or
+// no handler, then throw std::bad_alloc or return nullptr for nothrow. As llheap is compiled without exceptions, a new
+// handler throwing std::bad_alloc from a nothrow operator new terminates the program rather than returning nullptr.
+static __attribute__(( noinline )) void * newFail( size_t size, size_t alignment, bool nothrow STAT_PARM ) {
+	#ifdef __NULL_0_ALLOC__
+	if ( size == 0 ) {									// operator new must return a unique address for a zero request
+		size = 1;
+		void * addr = memalignNoStats( alignment, size STAT_ARG( STAT_NAME ) );
+	  if ( LIKELY( addr != nullptr ) ) return addr;
+	} // if
+	#endif // __NULL_0_ALLOC__
+
+	for ( ;; ) {
+		std::new_handler handler = std::get_new_handler();
+	  if ( handler == nullptr ) break;
+		handler();										// may release storage, throw, or terminate
+		void * addr = memalignNoStats( alignment, size STAT_ARG( STAT_NAME ) );
+	  if ( addr != nullptr ) return addr;
+	} // for
+
+	if ( nothrow ) return nullptr;
+	throwBadAlloc();
+} // newFail
+
+static inline __attribute__((always_inline)) void * doNew( size_t size, bool nothrow ) {
+	LLDEBUG( debugprt( "operator new %zd ", size ) );
+	void * addr = doSlabMalloc( size STAT_ARG( HeapStatistics::NEW ) );
+  if ( UNLIKELY( addr == nullptr ) ) return newFail( size, __ALIGN__, nothrow STAT_ARG( HeapStatistics::NEW ) );
+	return addr;
+} // doNew
+
+static inline __attribute__((always_inline)) void * doAlignedNew( size_t size, std::align_val_t alignment, bool nothrow ) {
+	LLDEBUG( debugprt( "operator new %zd %zd ", size, (size_t)alignment ) );
+	if ( UNLIKELY( size == 0 ) ) size = 1;				// memalign ignores the alignment for a zero request
+	void * addr = memalignNoStats( (size_t)alignment, size STAT_ARG( HeapStatistics::ALIGNED_NEW ) );
+  if ( UNLIKELY( addr == nullptr ) ) return newFail( size, (size_t)alignment, nothrow STAT_ARG( HeapStatistics::ALIGNED_NEW ) );
+	return addr;
+} // doAlignedNew
+
+static inline __attribute__((always_inline)) void doDelete( void * addr ) {
+	LLDEBUG( debugprt( "operator delete %p ", addr ) );
+  if ( UNLIKELY( addr == nullptr ) ) {					// special case
+		LLDEBUG( debugprt( "\n" ) );
+		#ifdef __STATISTICS__
+		if ( LIKELY( heapManager > (Heap *)1 ) ) { heapManager->stats.delete_null_0_calls += 1; }
+		else { Fai( heapMaster.stats.delete_null_0_calls, 1 ); }
+		#endif // __STATISTICS__
+		return;
+	} // if
+
+	doFree( addr STAT_ARG( HeapStatistics::DELETE ) );
+} // doDelete
+
+// C++14 sized deallocation. Aligned operator new increases a zero request to 1 byte, as does operator new with
+// __NULL_0_ALLOC__, so the size is only checked to be within the allocation.
+static inline __attribute__((always_inline)) void doSizedDelete( const char name[] __attribute__(( unused )), void * addr,
+			size_t size __attribute__(( unused )), size_t alignment ) {
+  if ( UNLIKELY( addr == nullptr ) ) { doDelete( addr ); return; } // null case handled by delete
+	bool fake = alignment > __ALIGN__;					// aligned operator new never requests zero bytes
+	#ifdef __DEBUG__
+	checkSized( name, addr, size, fake ? alignment : (size_t)__ALIGN__, false );
+	#endif // __DEBUG__
+	doFree( addr STAT_ARG( HeapStatistics::DELETE ), true, fake );
+} // doSizedDelete
+
+
+void * operator new( size_t size ) {
+	return doNew( size, false );
+} // operator new
+
+void * operator new[]( size_t size ) {
+	return doNew( size, false );
+} // operator new[]
+
+void * operator new( size_t size, const std::nothrow_t & ) noexcept {
+	return doNew( size, true );
+} // operator new
+
+void * operator new[]( size_t size, const std::nothrow_t & ) noexcept {
+	return doNew( size, true );
+} // operator new[]
+
+void * operator new( size_t size, std::align_val_t alignment ) {
+	return doAlignedNew( size, alignment, false );
+} // operator new
+
+void * operator new[]( size_t size, std::align_val_t alignment ) {
+	return doAlignedNew( size, alignment, false );
+} // operator new[]
+
+void * operator new( size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept {
+	return doAlignedNew( size, alignment, true );
+} // operator new
+
+void * operator new[]( size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept {
+	return doAlignedNew( size, alignment, true );
+} // operator new[]
+
+
+void operator delete( void * addr ) noexcept {
+	doDelete( addr );
+} // operator delete
+
+void operator delete[]( void * addr ) noexcept {
+	doDelete( addr );
+} // operator delete[]
+
+void operator delete( void * addr, const std::nothrow_t & ) noexcept {
+	doDelete( addr );
+} // operator delete
+
+void operator delete[]( void * addr, const std::nothrow_t & ) noexcept {
+	doDelete( addr );
+} // operator delete[]
+
+void operator delete( void * addr, std::align_val_t ) noexcept {
+	doDelete( addr );
+} // operator delete
+
+void operator delete[]( void * addr, std::align_val_t ) noexcept {
+	doDelete( addr );
+} // operator delete[]
+
+void operator delete( void * addr, std::align_val_t, const std::nothrow_t & ) noexcept {
+	doDelete( addr );
+} // operator delete
+
+void operator delete[]( void * addr, std::align_val_t, const std::nothrow_t & ) noexcept {
+	doDelete( addr );
+} // operator delete[]
+
+void operator delete( void * addr, size_t size ) noexcept {
+	doSizedDelete( "operator delete", addr, size, __ALIGN__ );
+} // operator delete
+
+void operator delete[]( void * addr, size_t size ) noexcept {
+	doSizedDelete( "operator delete[]", addr, size, __ALIGN__ );
+} // operator delete[]
+
+void operator delete( void * addr, size_t size, std::align_val_t alignment ) noexcept {
+	doSizedDelete( "operator delete", addr, size, (size_t)alignment );
+} // operator delete
+
+void operator delete[]( void * addr, size_t size, std::align_val_t alignment ) noexcept {
+	doSizedDelete( "operator delete[]", addr, size, (size_t)alignment );
+} // operator delete[]
+
+
 // zip -r llheap.zip heap/README.md heap/llheap.h heap/llheap.cc heap/Makefile heap/affinity.h heap/test.cc heap/ownership.cc
 
 // g++-14 -Wall -Wextra -g -O3 -DNDEBUG -D__STATISTICS__ -DTLS llheap.cc -fPIC -shared -o llheap.so
@@ -25,12 +25,35 @@ extern "C" {
 	int posix_aligned_realloc( void ** oaddrp, size_t nalignment, size_t size );
 	int posix_aligned_reallocarray( void ** oaddrp, size_t nalignment, size_t dimension, size_t elemSize );
 
+	// Sized deallocation (C23)
+	void free_sized( void * addr, size_t size );		// free + allocation size
+	void free_aligned_sized( void * addr, size_t alignment, size_t size ); // free + allocation alignment and size
+
+	// Batch operations
+	size_t malloc_batch( size_t size, size_t n, void ** out ) __attribute_warn_unused_result__; // n mallocs of size bytes (number allocated)
+	void free_batch( void ** ptrs, size_t n );			// n frees
+
+	// Explicit heaps
+	typedef struct heap_t heap_t;						// opaque heap handle
+	heap_t * heap_create( void ) __attribute_warn_unused_result__; // independent heap
+	void * heap_malloc( heap_t * heap, size_t size ) __attribute_warn_unused_result__ __attribute__ ((malloc)) __attribute_alloc_size__ ((2)); // malloc from heap
+	void heap_free( heap_t * heap, void * addr );		// free to heap
+	void heap_destroy( heap_t * heap );					// release all heap storage, freed or not
+
 	// New control operations
 	size_t malloc_thread_extend( void );				// heap-thread extend size (threads)
 	size_t malloc_heap_extend( void );					// heap extend size (bytes)
 	size_t malloc_thread_block( void );					// thread block size (bytes)
 	size_t malloc_mmap_start( void );					// crossover allocation size from sbrk to mmap
+	size_t malloc_purge_decay( void );					// idle time before free storage is returned to the OS (milliseconds)
+	size_t malloc_huge_pages( void );					// huge-page mode for heap storage (0 => none, 1 => transparent, 2 => hugetlb)
+	size_t malloc_mmap_cache( void );					// maximum storage of freed mapped allocations cached for reuse (bytes)
+	size_t malloc_numa( void );							// NUMA mode (0 => unaware, 1 => pool per node, N > 1 => emulate N nodes)
+	size_t malloc_exit_policy( void );					// terminating-thread heap policy (flags 1 => drain, 2 => trim, 4 => donate)
+	size_t malloc_sample_rate( void );					// average bytes allocated between heap-profile samples (0 => no sampling)
+	const unsigned int * malloc_size_classes( void );	// bucket sizes, nullptr => compiled size classes
 	size_t malloc_unfreed( void );						// amount subtracted to adjust for unfreed program storage (debug only)
+	size_t malloc_trim_bytes( size_t pad );				// release free storage to the operating system (bytes released)
 
 	// Preserved properties
 	size_t malloc_request_size( void * addr ) __attribute_warn_unused_result__;	// object's request size, malloc_request_size <= malloc_usable_size
@@ -44,6 +67,9 @@ extern "C" {
 	void malloc_stats_clear( void );					// clear global heap statistics
 	void heap_stats( void );							// print thread per heap statistics
 
+	// Heap profiling
+	int malloc_sample_dump( int fd );					// write sampled live allocations in pprof heap format (bytes written)
+
 	// If unsupport, create them, as supported in mallopt.
 	#ifndef M_MMAP_THRESHOLD
 	#define M_MMAP_THRESHOLD (-1)
@@ -53,8 +79,17 @@ extern "C" {
 	#define M_TOP_PAD (-2)
 	#endif // M_TOP_PAD
 
+	// llheap specific, as supported in mallopt.
+	#define M_PURGE_DECAY (-100)
+	#define M_HUGE_PAGES (-101)
+	#define M_MMAP_CACHE (-102)
+	#define M_NUMA (-103)
+	#define M_EXIT_POLICY (-104)
+	#define M_SAMPLE_RATE (-105)
+
+	int malloc_trim( size_t pad );						// release free storage to the operating system
+
 	// Unsupported
-	int malloc_trim( size_t );
 	void * malloc_get_state( void );
 	int malloc_set_state( void * );
 #ifdef __cplusplus
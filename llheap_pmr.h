@@ -0,0 +1,113 @@
+#pragma once
+
+// C++ adapters steering individual containers onto llheap without replacing the allocator for the whole program:
+//
+//   llheap::memory_resource : std::pmr::memory_resource for pmr containers, e.g., std::pmr::vector
+//   llheap::allocator       : std::allocator-compatible template for standard containers, e.g., std::vector
+//
+// Both take a minimum (sticky) alignment and a zero-fill option, and deallocate with a sized free, which checks the size
+// in the debug versions of llheap.
+
+#include <cstddef>										// size_t
+#include <new>											// bad_alloc, bad_array_new_length
+#include <memory_resource>								// pmr::memory_resource
+#include <type_traits>									// true_type
+#include "llheap.h"
+
+namespace llheap {
+	class memory_resource : public std::pmr::memory_resource {
+		size_t alignment;								// minimum alignment of all allocations
+		bool zeroFill;									// zero fill all allocations
+	  public:
+		explicit memory_resource( size_t alignment = alignof(std::max_align_t), bool zeroFill = false ) noexcept :
+			alignment( alignment ), zeroFill( zeroFill ) {}
+	  private:
+		size_t align( size_t alignment ) const noexcept { return alignment > this->alignment ? alignment : this->alignment; }
+
+		void * do_allocate( size_t bytes, size_t alignment ) override {
+			void * addr = zeroFill ? cmemalign( align( alignment ), 1, bytes ) : memalign( align( alignment ), bytes );
+			if ( addr == nullptr && bytes != 0 ) throw std::bad_alloc(); // zero request can return nullptr
+			return addr;
+		} // memory_resource::do_allocate
+
+		void do_deallocate( void * addr, size_t bytes, size_t alignment ) override {
+			free_aligned_sized( addr, align( alignment ), bytes );
+		} // memory_resource::do_deallocate
+
+		// All llheap resources share the same heaps, so storage from one can be freed by another.
+		bool do_is_equal( const std::pmr::memory_resource & other ) const noexcept override {
+			return this == &other || dynamic_cast<const memory_resource *>( &other ) != nullptr;
+		} // memory_resource::do_is_equal
+	}; // memory_resource
+
+	// Resource with default alignment and no zero fill, like std::pmr::new_delete_resource.
+	inline memory_resource * default_resource() noexcept {
+		static memory_resource resource;
+		return &resource;
+	} // default_resource
+
+
+	template< typename T, size_t Alignment = alignof(T), bool ZeroFill = false > class allocator {
+		static_assert( Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0, "alignment must be a power of 2 >= alignof(T)" );
+	  public:
+		using value_type = T;
+		using is_always_equal = std::true_type;			// all llheap allocators share the same heaps
+		using propagate_on_container_move_assignment = std::true_type;
+
+		template< typename U > struct rebind {
+			using other = allocator< U, (Alignment > alignof(U) ? Alignment : alignof(U)), ZeroFill >;
+		}; // rebind
+
+		allocator() noexcept = default;
+		template< typename U, size_t A > allocator( const allocator< U, A, ZeroFill > & ) noexcept {}
+
+		static constexpr size_t max_size() noexcept { return ~(size_t)0 / sizeof(T); }
+
+		T * allocate( size_t n ) {
+			if ( n > max_size() ) throw std::bad_array_new_length(); // aalloc/amemalign do not check overflow
+			void * addr = ZeroFill ? cmemalign( Alignment, n, sizeof(T) ) : amemalign( Alignment, n, sizeof(T) );
+			if ( addr == nullptr && n != 0 ) throw std::bad_alloc(); // zero request can return nullptr
+			return (T *)addr;
+		} // allocator::allocate
+
+		void deallocate( T * addr, size_t n ) noexcept {
+			free_aligned_sized( addr, Alignment, n * sizeof(T) );
+		} // allocator::deallocate
+
+		// Extensions for containers managing their own elements (not used by standard containers).
+
+		// Change the array to n elements without copying, i.e., contents are undefined (zero filled if ZeroFill).
+		// Storage is reused in place when possible, except for ZeroFill. addr is freed even on failure.
+		T * resize( T * addr, size_t n ) {
+			if ( n > max_size() ) { free( addr ); throw std::bad_array_new_length(); }
+			void * naddr;
+			if constexpr ( ZeroFill ) {					// resize does not preserve zero fill
+				free( addr );
+				naddr = cmemalign( Alignment, n, sizeof(T) );
+			} else {
+				naddr = aligned_resize( addr, Alignment, n * sizeof(T) );
+			} // if
+			if ( naddr == nullptr && n != 0 ) throw std::bad_alloc();
+			return (T *)naddr;
+		} // allocator::resize
+
+		// Change the array to n elements copying existing elements, which must be trivially copyable. New storage is
+		// zero filled if ZeroFill. On failure, addr is unchanged.
+		T * reallocate( T * addr, size_t n ) {
+			static_assert( std::is_trivially_copyable_v<T>, "reallocate requires trivially copyable elements" );
+			if ( n > max_size() ) throw std::bad_array_new_length();
+			void * naddr = aligned_realloc( addr, Alignment, n * sizeof(T) ); // sticky zero fill extends zero fill
+			if ( naddr == nullptr && n != 0 ) throw std::bad_alloc();
+			return (T *)naddr;
+		} // allocator::reallocate
+	}; // allocator
+
+	template< typename T, size_t TA, typename U, size_t UA, bool Z >
+	constexpr bool operator==( const allocator< T, TA, Z > &, const allocator< U, UA, Z > & ) noexcept { return true; }
+	template< typename T, size_t TA, typename U, size_t UA, bool Z >
+	constexpr bool operator!=( const allocator< T, TA, Z > &, const allocator< U, UA, Z > & ) noexcept { return false; }
+} // llheap
+
+// Local Variables: //
+// tab-width: 4 //
+// End: //
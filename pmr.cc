@@ -0,0 +1,84 @@
+// Compare container churn using the default allocator/resource with the llheap allocator/resource in llheap_pmr.h.
+// Link with an llheap library, e.g.:  g++ -O3 pmr.cc libllheap.o -lpthread
+
+#include <cstdio>										// printf
+#include <cstdint>										// uint64_t
+#include <cstring>										// strerror
+#include <cerrno>										// errno
+#include <ctime>										// clock_gettime
+#include <vector>
+#include <unordered_map>
+#include <memory_resource>								// pmr::new_delete_resource
+#include "llheap_pmr.h"
+using namespace std;
+
+static timespec currTime() {
+	timespec t;											// nanoseconds since UNIX epoch
+	if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t ) == -1 ) {
+		fprintf( stderr, "internal error, clock failed %d %s\n", errno, strerror( errno ) );
+	} // if
+	return t;
+} // currTime
+
+static inline double dur( timespec end, timespec start ) {
+	long int sec = end.tv_sec - start.tv_sec, nsec = end.tv_nsec - start.tv_nsec;
+	return sec + nsec * 1E-9;
+} // dur
+
+template< typename T > static inline T pass( T v ) {	// prevent eliding, cheaper than volatile
+	__asm__ __volatile__ ( "" : "+r"(v) );
+	return v ;
+} // pass
+
+enum : uint64_t { TIMES = 200'000, ELEMENTS = 1'000, KEYS = 1'000 };
+
+// Repeatedly grow a vector by push_back (reallocation at each doubling) and destroy it.
+template< typename Vector, typename... Args > static double vectorChurn( Args &&... args ) {
+	timespec start = currTime();
+	for ( uint64_t i = 0; i < TIMES; i += 1 ) {
+		Vector v( args... );
+		for ( uint64_t e = 0; e < ELEMENTS; e += 1 ) v.push_back( e );
+		pass( v.data() );
+	} // for
+	return dur( currTime(), start );
+} // vectorChurn
+
+// Repeatedly fill a map (one node allocation per insert plus rehashing) and destroy it.
+template< typename Map, typename... Args > static double mapChurn( Args &&... args ) {
+	timespec start = currTime();
+	for ( uint64_t i = 0; i < TIMES / 10; i += 1 ) {
+		Map m( args... );
+		for ( uint64_t k = 0; k < KEYS; k += 1 ) m[k] = k;
+		for ( uint64_t k = 0; k < KEYS; k += 2 ) m.erase( k );
+		pass( &m );
+	} // for
+	return dur( currTime(), start );
+} // mapChurn
+
+// llheap only
+extern "C" size_t malloc_unfreed() { return 4096; }		// printf(4096)
+
+int main() {
+	typedef unordered_map< uint64_t, uint64_t > Map;
+	typedef llheap::allocator< pair< const uint64_t, uint64_t > > MapAlloc;
+	typedef unordered_map< uint64_t, uint64_t, hash< uint64_t >, equal_to< uint64_t >, MapAlloc > LLMap;
+
+	printf( "vector push_back std::allocator\t\t\t%.2f\n", vectorChurn< vector< uint64_t > >() );
+	printf( "vector push_back llheap::allocator\t\t%.2f\n", vectorChurn< vector< uint64_t, llheap::allocator< uint64_t > > >() );
+	printf( "vector push_back llheap::allocator 64-align/0-fill\t%.2f\n",
+			vectorChurn< vector< uint64_t, llheap::allocator< uint64_t, 64, true > > >() );
+	printf( "pmr::vector push_back new_delete_resource\t%.2f\n", vectorChurn< pmr::vector< uint64_t > >( pmr::new_delete_resource() ) );
+	printf( "pmr::vector push_back llheap::memory_resource\t%.2f\n", vectorChurn< pmr::vector< uint64_t > >( llheap::default_resource() ) );
+
+	printf( "unordered_map insert/erase std::allocator\t%.2f\n", mapChurn< Map >() );
+	printf( "unordered_map insert/erase llheap::allocator\t%.2f\n", mapChurn< LLMap >() );
+	printf( "pmr::unordered_map insert/erase new_delete_resource\t%.2f\n",
+			mapChurn< pmr::unordered_map< uint64_t, uint64_t > >( pmr::new_delete_resource() ) );
+	printf( "pmr::unordered_map insert/erase llheap::memory_resource\t%.2f\n",
+			mapChurn< pmr::unordered_map< uint64_t, uint64_t > >( llheap::default_resource() ) );
+} // main
+
+// Local Variables: //
+// tab-width: 4 //
+// compile-command: "g++-14 -Wall -Wextra -O3 pmr.cc libllheap.o -lpthread" //
+// End: //
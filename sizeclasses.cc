@@ -0,0 +1,117 @@
+// Tune the llheap size classes to a workload from the bucket usage printed by malloc_stats with MALLOC_STATS=1, e.g.:
+//
+//   MALLOC_STATS=1 ./program 2> stats.txt
+//   ./sizeclasses < stats.txt
+//
+// Each heavily used class with a large average internal fragmentation gets a new class fitting its average request, and
+// the classes whose removal moves the least storage are dropped to keep the table size. The result is printed as a
+// MALLOC_SIZE_CLASSES setting; the list after '=' can also be saved in a file for compiling with __SIZE_CLASSES_FILE__.
+// The estimate assumes requests in a bucket cluster around their average, so rerun the workload with the new table.
+//
+// Compile:  g++ -O2 sizeclasses.cc -o sizeclasses
+//           g++ -O2 -D__COMPACT_HEADER__ sizeclasses.cc -o sizeclasses	(for llheap built with 8-byte headers)
+
+#include <cstdio>										// printf
+#include <cstdlib>										// strtoul
+#include <iostream>										// cin
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+using namespace std;
+
+enum : size_t { NoBucketSizes = 64,						// llheap table size
+				#ifdef __COMPACT_HEADER__
+				HeaderSize = 8,							// llheap compact allocation header
+				#else
+				HeaderSize = 16,						// llheap allocation header
+				#endif // __COMPACT_HEADER__
+				MinClassSize = 32,						// llheap classes exceed its 16-byte free-block header
+				MinUsePercent = 1,						// tune buckets with at least 1% of the uses
+				MinWaste = 16 };						// and an average internal fragmentation of at least 16 bytes
+
+struct Bucket { size_t uses = 0, request = 0; bool pinned = false; };
+
+static size_t number( const string & str ) {			// remove thousands separators
+	string digits;
+	for ( char c : str ) if ( c != ',' ) digits += c;
+	return strtoul( digits.c_str(), nullptr, 10 );
+} // number
+
+static size_t ceiling( size_t value, size_t align ) { return (value + align - 1) / align * align; }
+
+int main() {
+	map< size_t, Bucket > buckets;						// class size => usage, summed over all heaps
+	vector< size_t > classes;							// current size classes
+	const regex entry( "([0-9,]+)/([0-9,]+)/([0-9,]+)/([0-9,]+)/[0-9]+%" ), number_( "[0-9]+" );
+
+	for ( string line; getline( cin, line ); ) {
+		if ( line.compare( 0, 14, "Size classes: " ) == 0 ) {
+			classes.clear();
+			for ( sregex_iterator i( line.begin(), line.end(), number_ ), end; i != end; ++i ) classes.push_back( number( i->str() ) );
+			continue;
+		} // if
+		for ( sregex_iterator i( line.begin(), line.end(), entry ), end; i != end; ++i ) {
+			Bucket & bucket = buckets[number( (*i)[1] )];
+			bucket.uses += number( (*i)[2] ) + number( (*i)[3] ); // allocations + reuses
+			bucket.request += number( (*i)[4] );
+		} // for
+	} // for
+	if ( classes.size() != NoBucketSizes || buckets.empty() ) {
+		fprintf( stderr, "no bucket usage found: run the program with MALLOC_STATS=1 and a statistics build of llheap\n" );
+		return 1;
+	} // if
+
+	size_t uses = 0, used = 0, request = 0;
+	for ( auto & [size, bucket] : buckets ) {
+		uses += bucket.uses; used += size * bucket.uses; request += bucket.request;
+	} // for
+	printf( "%10s %12s %12s %8s\n", "class", "uses", "avg request", "waste%" );
+	for ( auto & [size, bucket] : buckets ) {
+		printf( "%10zu %12zu %12zu %7.1f%%\n", size, bucket.uses, bucket.request / bucket.uses,
+				(double)(size * bucket.uses - bucket.request) / (size * bucket.uses) * 100.0 );
+	} // for
+	printf( "total %zu uses, internal fragmentation %.1f%%\n", uses, (double)(used - request) / used * 100.0 );
+
+	// Insert a class fitting the average request of each heavily used, wasteful bucket.
+	map< size_t, Bucket > table;
+	for ( size_t size : classes ) table[size] = buckets.count( size ) ? buckets[size] : Bucket();
+	for ( auto & [size, bucket] : buckets ) {
+	  if ( bucket.uses * 100 < uses * MinUsePercent ) continue;
+		size_t avg = bucket.request / bucket.uses;
+	  if ( size < HeaderSize + avg + MinWaste ) continue;
+		size_t fit = ceiling( avg + HeaderSize, 16 );
+		auto prev = table.lower_bound( size );
+	  if ( fit < MinClassSize || (prev != table.begin() && std::prev( prev )->first >= fit) ) continue; // existing class fits ?
+		table[fit] = Bucket{ bucket.uses, bucket.request, true }; // assume the requests move to the new class
+		table[size].pinned = true;						// keep the class for the larger requests
+	} // for
+
+	// Remove the classes whose uses move the least storage to the next larger class, never the smallest class, which
+	// holds the smallest requests and must exceed the header for llheap to accept the table, or the largest class.
+	table.begin()->second.pinned = true;
+	while ( table.size() > NoBucketSizes ) {
+		auto victim = table.end();
+		size_t cost = ~(size_t)0;
+		for ( auto i = table.begin(); next( i ) != table.end(); ++i ) {
+		  if ( i->second.pinned ) continue;
+			size_t c = i->second.uses * (next( i )->first - i->first);
+			if ( c < cost ) { cost = c; victim = i; }
+		} // for
+	  if ( victim == table.end() ) break;				// all classes pinned
+		next( victim )->second.uses += victim->second.uses;
+		table.erase( victim );
+	} // while
+	if ( table.size() != NoBucketSizes ) {
+		fprintf( stderr, "too many tuned classes, retry with fewer heavily used buckets\n" );
+		return 1;
+	} // if
+
+	printf( "MALLOC_SIZE_CLASSES=" );
+	for ( auto i = table.begin(); i != table.end(); ++i ) printf( "%zu%s", i->first, next( i ) != table.end() ? "," : "\n" );
+} // main
+
+// Local Variables: //
+// tab-width: 4 //
+// compile-command: "g++-14 -Wall -Wextra -O2 sizeclasses.cc -o sizeclasses" //
+// End: //
@@ -1,9 +1,11 @@
 #include <string>										// stoi
 #include <cstdarg>										// va_start, va_end
+#include <new>											// nothrow, bad_alloc
 using namespace std;
 // Use C I/O because cout does not a good mechanism for thread-safe I/O.
 #include <string.h>										// strlen, strerror
 #include <unistd.h>										// sysconf
+#include <sys/mman.h>									// mincore
 #include "llheap.h"
 #include "affinity.h"
 
@@ -287,6 +289,126 @@ void * worker( void * ) {
 		} // for
 	} // for
 
+	// check malloc/free_sized (sbrk/mmap)
+
+	for ( int i = 0; i < NoOfAllocs; i += 1 ) {
+		size_t s = i;									// include size 0
+		char * area = (char *)malloc( s );
+		if ( s != 0 ) { area[0] = '\345'; area[s - 1] = '\345'; } // fill first/last
+		free_sized( area, s );
+	} // for
+
+	for ( int i = 0; i < NoOfMmaps; i += 1 ) {
+		size_t s = i + malloc_mmap_start();				// cross over point
+		char * area = (char *)malloc( s );
+		area[0] = '\345'; area[s - 1] = '\345';			// fill first/last
+		free_sized( area, s );
+	} // for
+	free_sized( nullptr, 0 );
+
+	// check aligned_alloc/free_aligned_sized (sbrk/mmap)
+
+	for ( size_t a = __ALIGN__ / 2; a <= limit; a += a ) { // generate powers of 2, including below minimum alignment
+		for ( int s = 0; s < NoOfAllocs; s += 17 ) {	// include size 0
+			char * area = (char *)aligned_alloc( a, s );
+			if ( s != 0 ) { area[0] = '\345'; area[s - 1] = '\345'; } // fill first/last
+			free_aligned_sized( area, a, s );
+		} // for
+		for ( int i = 1; i < NoOfMmaps; i += 1 ) {
+			size_t s = i + malloc_mmap_start();			// cross over point
+			char * area = (char *)aligned_alloc( a, s );
+			area[0] = '\345'; area[s - 1] = '\345';		// fill first/last byte
+			free_aligned_sized( area, a, s );
+		} // for
+	} // for
+
+	// check sized new/delete
+
+	struct Sized { char c[48]; };
+	struct alignas(256) Aligned { char c[300]; };
+	for ( int i = 0; i < NoOfAllocs; i += 1 ) {
+		Sized * sp = new Sized;
+		Aligned * ap = new Aligned;
+		if ( (size_t)ap % alignof(Aligned) != 0 ) abort( "sized new/delete bad alignment %p", ap );
+		sp->c[0] = sp->c[sizeof(sp->c) - 1] = ap->c[0] = ap->c[sizeof(ap->c) - 1] = '\345'; // fill first/last
+		delete sp;										// operator delete( void *, size_t )
+		delete ap;										// operator delete( void *, size_t, align_val_t )
+	} // for
+
+	// check new failure
+
+	if ( new ( std::nothrow ) char[(size_t)1 << 60] != nullptr ) abort( "nothrow new did not fail" );
+	if ( new ( std::nothrow ) Aligned[(size_t)1 << 50] != nullptr ) abort( "aligned nothrow new did not fail" );
+	try {
+		char * cp = new char[(size_t)1 << 60];
+		abort( "new did not fail %p", cp );
+	} catch( std::bad_alloc & ) {}
+
+	// check malloc_batch/free_batch (sbrk/mmap)
+
+	for ( int r = 0; r < 4; r += 1 ) {
+		size_t sizes[] = { 0, 42, 1000, malloc_mmap_start() + 1 };
+		for ( size_t s : sizes ) {
+			size_t n = s < malloc_mmap_start() ? NoOfAllocs : NoOfMmaps;
+			size_t cnt = malloc_batch( s, n, (void **)locns );
+			if ( cnt != n ) abort( "malloc_batch failed : malloc_batch( %zd, %zd ) = %zd", s, n, cnt );
+			for ( size_t i = 0; i < n; i += 1 ) {
+				if ( (size_t)locns[i] % __ALIGN__ != 0 || malloc_request_size( locns[i] ) != s ) {
+					abort( "malloc_batch bad block : malloc_batch( %zd, %zd )[%zd] = %p", s, n, i, locns[i] );
+				} // if
+				if ( s ) { locns[i][0] = '\345'; locns[i][s - 1] = '\345'; } // fill first/last byte
+				locns[i][malloc_usable_size( locns[i] ) - 1] = '\345'; // fill ultimate byte
+			} // for
+			for ( size_t i = 0; i < n; i += 3 ) { free( locns[i] ); locns[i] = nullptr; } // free with holes
+			free_batch( (void **)locns, n );
+		} // for
+	} // for
+
+	// check malloc_request_size of adjacent allocations filled to their request size (sbrk/mmap)
+
+	for ( size_t a = __ALIGN__; a <= 64 * 1024; a *= 64 ) {
+		size_t n = 0;
+		for ( size_t s = 24; s < 4 * 1024 * 1024; s += s / 4 + 8 ) { // calloc => header even with slabs
+			locns[n] = (char *)(a == __ALIGN__ ? calloc( 1, s ) : cmemalign( a, 1, s ));
+			if ( (size_t)locns[n] % a != 0 || malloc_request_size( locns[n] ) != s ) {
+				abort( "malloc_request_size bad block : %zd %zd %p %zd", a, s, locns[n], malloc_request_size( locns[n] ) );
+			} // if
+			n += 1;
+		} // for
+		locns[n] = (char *)malloc( malloc_mmap_start() + 1 );
+		n += 1;
+		for ( size_t i = 0; i < n; i += 1 ) memset( locns[i], i, malloc_request_size( locns[i] ) );
+		for ( size_t i = 0; i < n; i += 1 ) {
+			size_t s = malloc_request_size( locns[i] );
+			if ( s < 24 || locns[i][0] != (char)i || locns[i][s - 1] != (char)i || malloc_zero_fill( locns[i] ) != (i != n - 1) ) {
+				abort( "malloc_request_size corrupt storage : %zd %zd %p %zd", a, i, locns[i], s );
+			} // if
+			free( locns[i] );
+		} // for
+	} // for
+
+	// check explicit heaps (sbrk/mmap), destroy with unfreed storage
+
+	for ( int r = 0; r < 4; r += 1 ) {					// reuse destroyed heaps
+		heap_t * heap = heap_create();
+	  if ( heap == nullptr ) break;						// unsupported (per-CPU heaps) ?
+		char * areas[NoOfAllocs];
+		for ( int i = 0; i < NoOfAllocs; i += 1 ) {
+			size_t s = i % 10 == 0 ? i + malloc_mmap_start() : i; // some large allocations
+			areas[i] = (char *)heap_malloc( heap, s );
+			if ( areas[i] == nullptr ) abort( "heap_malloc failed : heap_malloc( %p, %zd )", heap, s );
+			if ( (size_t)areas[i] % __ALIGN__ != 0 ) abort( "heap_malloc bad alignment : heap_malloc( %p, %zd ) = %p", heap, s, areas[i] );
+			areas[i][malloc_usable_size( areas[i] ) - 1] = '\345'; // fill ultimate byte
+		} // for
+		for ( int i = 0; i < NoOfAllocs; i += 2 ) heap_free( heap, areas[i] ); // free half, small and large
+		for ( int i = 0; i < NoOfAllocs; i += 2 ) {		// reuse freed storage
+			areas[i] = (char *)heap_malloc( heap, i );
+			if ( areas[i] == nullptr ) abort( "heap_malloc failed : heap_malloc( %p, %d )", heap, i );
+		} // for
+		heap_free( heap, nullptr );
+		heap_destroy( heap );							// remaining storage released
+	} // for
+
 	// check posix_memalign/free (sbrk)
 
 	for ( size_t a = __ALIGN__; a <= limit; a += a ) {	// generate powers of 2
@@ -426,6 +548,39 @@ void * worker( void * ) {
 		free( area );
 	} // for
 
+	// check memalign/realloc/free (mremap), growing mapped storage in place of copying
+
+	for ( size_t a = __ALIGN__; a <= (size_t)sysconf( _SC_PAGESIZE ); a *= 4 ) {
+		size_t s = malloc_mmap_start() + 1;
+		char * area = (char *)memalign( a, s );
+		for ( size_t k = 0; k < s; k += 256 ) area[k] = (char)(k / 256); // fill pattern
+		for ( size_t n = s * 2; n <= s * 16; n *= 2 ) {	// grow mapping
+			area = (char *)realloc( area, n );
+			if ( (size_t)area % a != 0 || malloc_alignment( area ) != a || malloc_request_size( area ) != n ) {
+				abort( "memalign/realloc/free (mremap) bad block : memalign( %zd, %zd ) realloc %zd = %p", a, s, n, area );
+			} // if
+			for ( size_t k = 0; k < n / 2; k += 256 ) {
+				if ( area[k] != (char)(k / 256) ) abort( "memalign/realloc/free (mremap) corrupt storage at %zd", k );
+			} // for
+			for ( size_t k = n / 2 / 256 * 256 + 256; k < n; k += 256 ) area[k] = (char)(k / 256); // fill added storage
+		} // for
+		free( area );
+	} // for
+
+	for ( int r = 0; r < 4; r += 1 ) {
+		size_t s = malloc_mmap_start() + 1 + r * 1000;
+		char * area = (char *)calloc( 1, s );
+		area[0] = area[s - 1] = '\345';
+		for ( size_t n = s * 2; n <= s * 16; n *= 2 ) {	// grow zero-filled mapping
+			area = (char *)realloc( area, n );
+			if ( area[0] != '\345' || ! malloc_zero_fill( area ) ) abort( "calloc/realloc/free (mremap) corrupt storage" );
+			for ( size_t k = n / 2; k < n; k += 1 ) {
+				if ( area[k] != '\0' ) abort( "calloc/realloc/free (mremap) added storage not zero filled at %zd", k );
+			} // for
+		} // for
+		free( area );
+	} // for
+
 	// check calloc/realloc/free (sbrk)
 
 	for ( int i = 1; i < 10000; i += 12 ) {
@@ -744,10 +899,75 @@ void * worker( void * ) {
 		free( area );
 	} // for
 
+	// check malloc/free/malloc_trim
+
+	for ( int i = 0; i < NoOfMmaps; i += 1 ) {
+		size_t s = (i + 1) * 64 * 1024;					// multiple pages, below mmap crossover
+		locns[i] = (char *)malloc( s );
+		memset( locns[i], '\345', s );					// make pages resident
+	} // for
+	for ( int i = 0; i < NoOfMmaps; i += 1 ) free( locns[i] );
+	if ( malloc_trim_bytes( 0 ) == 0 ) abort( "malloc/free/malloc_trim released no storage" );
+	{
+		size_t page = sysconf( _SC_PAGESIZE );
+		char * interior = (char *)(((uintptr_t)locns[NoOfMmaps - 1] + page * 2) & ~(page - 1)); // page inside free block
+		unsigned char resident;
+		if ( mincore( interior, page, &resident ) == -1 || (resident & 1) ) abort( "malloc/free/malloc_trim page not released" );
+	}
+	for ( int i = 0; i < NoOfMmaps; i += 1 ) {
+		size_t s = (i + 1) * 64 * 1024;
+		char * area = (char *)calloc( 1, s );			// reuse trimmed blocks
+		if ( area[0] != '\0' || area[s / 2] != '\0' || area[s - 1] != '\0' ) abort( "malloc/free/malloc_trim corrupt storage" );
+		area[0] = area[s / 2] = area[s - 1] = '\345';	// trimmed pages are writable
+		free( area );
+	} // for
+
 	printf( "worker %lu successful completion\n", pthread_self() );
 	return nullptr;
 } // worker
 
+static void * sharer( void * ) {						// frees on a CPU heap shared with other threads
+	for ( int i = 0; i < 1'000'000; i += 1 ) {
+		void * volatile area = malloc( 256 );			// volatile prevents eliding malloc/free pair
+		free( area );
+	} // for
+	return nullptr;
+} // sharer
+
+static void * freer( void * ) {							// frees storage on another CPU, possibly into its CPU heap
+	enum { NoOfAllocs = 16, BlockSize = 64 * 1024 };
+	char * locns[NoOfAllocs];
+	for ( int i = 0; i < NoOfAllocs; i += 1 ) {
+		locns[i] = (char *)malloc( BlockSize );
+		memset( locns[i], '\345', BlockSize );			// make pages resident
+	} // for
+	for ( int i = 0; i < NoOfAllocs; i += 1 ) free( locns[i] );
+	return (void *)(uintptr_t)locns[NoOfAllocs - 1];
+} // freer
+
+static pthread_key_t exitKey;
+static void exitFree( void * block ) { free( block ); } // key destructor run after llheap's at thread exit
+static void * exiter( void * block ) {					// free a remote block after the thread's heap is parked
+	void * volatile local = malloc( 16 );				// create the thread's heap, so remote frees are batched
+	free( local );
+	if ( pthread_setspecific( exitKey, block ) != 0 ) abort();
+	return nullptr;
+} // exiter
+static void * remoteFree( void * block ) { free( block ); return nullptr; }
+
+// Allocate blocks of size until the block at prev is reused, returning true if found.
+static bool reclaim( uintptr_t prev, size_t size ) {
+	enum { Tries = 64 };
+	void * locns[Tries];
+	int i;
+	for ( i = 0; i < Tries; i += 1 ) {
+		locns[i] = malloc( size );
+	  if ( (uintptr_t)locns[i] == prev ) break;
+	} // for
+	for ( int j = 0; j < i + (i < Tries); j += 1 ) free( locns[j] );
+	return i < Tries;
+} // reclaim
+
 int main( int argc, char *argv[] ) {
 	setlocale( LC_NUMERIC, getenv( "LANG" ) );
 
@@ -765,6 +985,35 @@ int main( int argc, char *argv[] ) {
 	} // try
 	printf("Number of Threads: %d\n\n", Threads);
 
+	// check realloc grows the last bump-allocated block in place, while the heap has no free storage for larger sizes
+
+	if ( heap_t * heap = heap_create(); heap != nullptr ) { // per-CPU heaps share the bump buffer => no growth in place
+		heap_destroy( heap );
+		size_t s = 5000;
+		char * area = (char *)calloc( 1, s ), * start = area;
+		for ( ; s < 40'000; s += s / 4 ) {				// grow zero-filled block
+			area[s - 1] = '\345';
+			area = (char *)realloc( area, s + s / 4 );
+			if ( area != start ) abort( "realloc/calloc grow in place moved : %p %p %zd", start, area, s );
+			if ( area[s - 1] != '\345' || ! malloc_zero_fill( area ) ) abort( "realloc/calloc grow in place corrupt storage %zd", s );
+			for ( size_t k = s; k < s + s / 4; k += 1 ) {
+				if ( area[k] != '\0' ) abort( "realloc/calloc grow in place added storage not zero filled at %zd", k );
+			} // for
+		} // for
+		char * area2 = (char *)malloc( s = 50'000 ), * start2 = area2; // last bump block
+		for ( size_t k = 0; k < s; k += 1 ) area2[k] = (char)k;
+		for ( ; s < 400'000; s += s / 4 ) {				// grow block
+			area2 = (char *)realloc( area2, s + s / 4 );
+			if ( area2 != start2 ) abort( "realloc grow in place moved : %p %p %zd", start2, area2, s );
+			for ( size_t k = 0; k < 50'000; k += 1 ) if ( area2[k] != (char)k ) abort( "realloc grow in place corrupt storage at %zd", k );
+		} // for
+		free( area );
+		free( area2 );
+	} // if
+
+	mallopt( M_SAMPLE_RATE, 64 * 1024 );				// sample the workers' allocations
+	mallopt( M_NUMA, 4 );								// emulate NUMA nodes => workers' thread blocks from several pools
+
 	pthread_t thread[Threads];							// thread[0] unused
 
 	affinity( pthread_self(), 0 );
@@ -781,6 +1030,131 @@ int main( int argc, char *argv[] ) {
 #else
 	worker( nullptr );
 #endif // 0
+	mallopt( M_NUMA, 0 );
+
+	// check mmap cache reuse, and zero fill of a reused mapping
+
+	{
+		size_t s = malloc_mmap_start() * 2;
+		volatile char * area = (volatile char *)malloc( s ); // volatile prevents eliding stores before free
+		for ( size_t i = 0; i < s; i += 1 ) area[i] = '\345'; // dirty cached mapping
+		uintptr_t prev = (uintptr_t)area;
+		free( (void *)area );
+		area = (volatile char *)calloc( 1, s );
+		if ( (uintptr_t)area != prev ) abort( "mmap cache mapping not reused : %p %p", (void *)prev, (void *)area );
+		for ( size_t i = 0; i < s; i += 1 ) if ( area[i] != '\0' ) abort( "mmap cache calloc not zero filled at %zd", i );
+		free( (void *)area );
+		mallopt( M_MMAP_CACHE, s / 2 );					// shrink below cached storage
+		area = (volatile char *)malloc( s );
+		if ( (uintptr_t)area != prev ) abort( "mmap cache mapping not reused after shrink : %p %p", (void *)prev, (void *)area );
+		free( (void *)area );							// not cached
+		mallopt( M_MMAP_CACHE, 128 * 1024 * 1024 );		// default
+	}
+
+	// check threads sharing a CPU, and its heap with __PERCPU__, do not lose the amortized decay check (checked below)
+
+	{
+		enum { Sharers = 4 };
+		pthread_t sharers[Sharers];
+		pthread_attr_t attr;
+		cpu_set_t cpu;
+		CPU_ZERO( &cpu );
+		CPU_SET( sched_getcpu(), &cpu );
+		pthread_attr_init( &attr );
+		pthread_attr_setaffinity_np( &attr, sizeof(cpu), &cpu );
+		for ( int i = 0; i < Sharers; i += 1 ) if ( pthread_create( &sharers[i], &attr, sharer, nullptr ) != 0 ) abort();
+		for ( int i = 0; i < Sharers; i += 1 ) if ( pthread_join( sharers[i], nullptr ) != 0 ) abort();
+		pthread_attr_destroy( &attr );
+	}
+
+	// check decay of idle free storage
+
+	{
+		enum { NoOfAllocs = 64, BlockSize = 64 * 1024 };
+		char * locns[NoOfAllocs];
+		mallopt( M_PURGE_DECAY, 10 );					// milliseconds
+		for ( int i = 0; i < NoOfAllocs; i += 1 ) {
+			locns[i] = (char *)malloc( BlockSize );
+			memset( locns[i], '\345', BlockSize );		// make pages resident
+		} // for
+		for ( int i = 0; i < NoOfAllocs; i += 1 ) free( locns[i] ); // burst of frees, then idle
+		for ( int r = 0; r < 2; r += 1 ) {				// first check ages the free blocks, second releases them
+			usleep( 20'000 );							// past decay time
+			for ( int i = 0; i < 10'000; i += 1 ) {		// frees trigger a decay check
+				void * volatile area = malloc( 256 );	// volatile prevents eliding malloc/free pair
+				free( area );
+			} // for
+		} // for
+		size_t page = sysconf( _SC_PAGESIZE );
+		char * interior = (char *)(((uintptr_t)locns[0] + page * 2) & ~(page - 1)); // page inside free block
+		unsigned char resident;
+		if ( mincore( interior, page, &resident ) == -1 || (resident & 1) ) abort( "decay page not released" );
+		mallopt( M_PURGE_DECAY, 0 );
+	}
+
+	// check malloc_trim releases storage freed by a thread on another CPU, e.g., into another CPU heap with __PERCPU__
+
+	{
+		pthread_t thread;
+		pthread_attr_t attr;
+		cpu_set_t cpus;
+		for ( unsigned int c = 0; c < CPU_SETSIZE; c += 1 ) CPU_SET( c, &cpus ); // unpin, so malloc_trim reaches all CPUs
+		sched_setaffinity( 0, sizeof(cpus), &cpus );	// restricted to the process's CPUs
+		pthread_attr_init( &attr );
+		if ( sched_getaffinity( 0, sizeof(cpus), &cpus ) == 0 && CPU_COUNT( &cpus ) > 1 ) { // another CPU ?
+			CPU_CLR( sched_getcpu(), &cpus );
+			pthread_attr_setaffinity_np( &attr, sizeof(cpus), &cpus );
+		} // if
+		void * block;
+		if ( pthread_create( &thread, &attr, freer, nullptr ) != 0 || pthread_join( thread, &block ) != 0 ) abort();
+		pthread_attr_destroy( &attr );
+		malloc_trim( 0 );
+		size_t page = sysconf( _SC_PAGESIZE );
+		char * interior = (char *)(((uintptr_t)block + page * 2) & ~(page - 1)); // page inside free block
+		unsigned char resident;
+		if ( mincore( interior, page, &resident ) == -1 || (resident & 1) ) abort( "malloc_trim page freed on another CPU not released" );
+	}
+
+	// check malloc_sample_dump
+
+	{
+		enum { NoOfAllocs = 1000 };
+		char * locns[NoOfAllocs], profile[256];
+		size_t live[2];
+		for ( int i = 0; i < NoOfAllocs; i += 1 ) locns[i] = (char *)malloc( 16 * 1024 ); // 16M => ~250 samples
+		for ( int r = 0; r < 2; r += 1 ) {
+			FILE * fp = tmpfile();
+			int fd = fileno( fp );
+			if ( malloc_sample_dump( fd ) <= 0 || pread( fd, profile, sizeof(profile) - 1, 0 ) <= 0 ) abort( "malloc_sample_dump failed" );
+			profile[sizeof(profile) - 1] = '\0';
+			if ( sscanf( profile, "heap profile: %zu:", &live[r] ) != 1 || ! strstr( profile, "@ heap_v2/65536\n" ) ) {
+				abort( "malloc_sample_dump bad profile : %.40s", profile );
+			} // if
+			fclose( fp );
+			if ( r == 0 ) for ( int i = 0; i < NoOfAllocs; i += 1 ) free( locns[i] ); // remove samples
+		} // for
+		if ( live[0] < live[1] + NoOfAllocs / 16 ) abort( "malloc_sample_dump samples not freed : %zd %zd", live[0], live[1] );
+		mallopt( M_SAMPLE_RATE, 0 );
+	}
+
+	// check a remote free by an exiting thread after its heap is parked returns the block to its owner, when a remote
+	// free by a running thread does (ownership or a shared CPU heap, not the depot)
+
+	{
+		enum { BlockSize = 1'500'000 };					// rarely used bucket
+		pthread_t thread;
+		void * block = malloc( BlockSize );
+		uintptr_t prev = (uintptr_t)block;
+		if ( pthread_create( &thread, nullptr, remoteFree, block ) != 0 || pthread_join( thread, nullptr ) != 0 ) abort();
+		if ( reclaim( prev, BlockSize ) ) {				// remote frees return to owner ?
+			if ( pthread_key_create( &exitKey, exitFree ) != 0 ) abort(); // created after llheap's key => destructor runs later
+			block = malloc( BlockSize );
+			prev = (uintptr_t)block;
+			if ( pthread_create( &thread, nullptr, exiter, block ) != 0 || pthread_join( thread, nullptr ) != 0 ) abort();
+			if ( ! reclaim( prev, BlockSize ) ) abort( "remote free after thread heap parked not returned to owner" );
+			pthread_key_delete( exitKey );
+		} // if
+	}
 
 	malloc_stats();
 } // main